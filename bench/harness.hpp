@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <iomanip>
+
+// NOTE: Minimal benchmark harness: every case is calibrated so that one
+//       repetition takes at least "min_repetition_time", then run for
+//       a number of warmup and measured repetitions. Reported times are
+//       per single invocation of the benchmarked function
+
+namespace bench {
+
+inline const void* volatile sink;
+
+// NOTE: Makes compiler assume that value is observed, so that the
+//       computation producing it can not be optimized away
+template <typename T>
+void keep(const T& value) {
+	sink = &value;
+	std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+struct Result {
+	std::string name;
+	size_t iterations;     // NOTE: Invocations per repetition
+	size_t items;          // NOTE: Processed items per invocation
+	double median_ns;
+	double p99_ns;
+	double min_ns;
+	double mean_ns;
+};
+
+struct Options {
+	size_t warmup = 3;
+	size_t repetitions = 31;
+	std::chrono::nanoseconds min_repetition_time = std::chrono::microseconds(500);
+	std::string filter;
+};
+
+class Harness {
+public:
+	explicit Harness(const Options& options) : options{options} {}
+
+	template <typename Func>
+	void run(const std::string& name, size_t items, Func&& func) {
+		if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+			return;
+		}
+
+		using clock = std::chrono::steady_clock;
+
+		auto measure = [&](size_t iterations) {
+			auto start = clock::now();
+			for (size_t i = 0; i < iterations; ++i) {
+				func();
+			}
+			return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+		};
+
+		size_t iterations = 1;
+		while (measure(iterations) < double(options.min_repetition_time.count()) &&
+		       iterations < (size_t(1) << 30)) {
+			iterations *= 2;
+		}
+
+		for (size_t i = 0; i < options.warmup; ++i) {
+			measure(iterations);
+		}
+
+		std::vector<double> samples(std::max<size_t>(options.repetitions, 1));
+		for (double& sample : samples) {
+			sample = measure(iterations) / double(iterations);
+		}
+
+		std::sort(samples.begin(), samples.end());
+
+		double sum = 0.0;
+		for (double sample : samples) {
+			sum += sample;
+		}
+
+		const size_t count = samples.size();
+
+		results.push_back(Result{
+			.name = name,
+			.iterations = iterations,
+			.items = items,
+			.median_ns = count % 2 ? samples[count / 2]
+			                       : 0.5 * (samples[count / 2 - 1] + samples[count / 2]),
+			.p99_ns = samples[std::min(count - 1, size_t(double(count - 1) * 0.99 + 0.5))],
+			.min_ns = samples.front(),
+			.mean_ns = sum / double(count),
+		});
+	}
+
+	void writeTable(std::ostream& stream) const {
+		stream << std::left << std::setw(40) << "benchmark"
+		       << std::right << std::setw(14) << "median ns"
+		       << std::setw(14) << "p99 ns"
+		       << std::setw(14) << "ns/item" << '\n';
+
+		for (const Result& result : results) {
+			stream << std::left << std::setw(40) << result.name
+			       << std::right << std::fixed << std::setprecision(1)
+			       << std::setw(14) << result.median_ns
+			       << std::setw(14) << result.p99_ns
+			       << std::setprecision(3)
+			       << std::setw(14) << result.median_ns / double(std::max<size_t>(result.items, 1))
+			       << '\n';
+		}
+	}
+
+	void writeJSON(std::ostream& stream) const {
+		stream << "{\n\t\"benchmarks\": [\n";
+
+		for (size_t i = 0; i < results.size(); ++i) {
+			const Result& result = results[i];
+
+			stream << std::setprecision(6) << std::fixed
+			       << "\t\t{\"name\": \"" << result.name << '"'
+			       << ", \"iterations\": " << result.iterations
+			       << ", \"items\": " << result.items
+			       << ", \"median_ns\": " << result.median_ns
+			       << ", \"p99_ns\": " << result.p99_ns
+			       << ", \"min_ns\": " << result.min_ns
+			       << ", \"mean_ns\": " << result.mean_ns
+			       << (i + 1 < results.size() ? "},\n" : "}\n");
+		}
+
+		stream << "\t]\n}\n";
+	}
+
+private:
+	Options options;
+	std::vector<Result> results;
+};
+
+} // namespace bench
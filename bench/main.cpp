@@ -0,0 +1,268 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <random>
+#include <memory>
+#include <iostream>
+#include <fstream>
+
+#include <veekay/veekay.hpp>
+
+#include "harness.hpp"
+
+namespace {
+
+// NOTE: Same layout as testbed uniforms, so that packing cost is representative
+struct ModelUniforms {
+	veekay::affine3x4 model;
+	veekay::vec3 albedo_color; float _pad0;
+};
+
+struct LegacyModelUniforms {
+	veekay::mat4 model;
+	veekay::vec3 albedo_color; float _pad0;
+};
+
+constexpr size_t transform_count = 100'000;
+constexpr size_t uniform_count = 1024;
+
+// NOTE: Dynamic uniform buffers are commonly aligned to 64 or 256 bytes,
+//       this emulates a mapped region without needing a Vulkan device
+constexpr size_t uniform_alignment = 256;
+
+float randomFloat(std::mt19937& engine, float min, float max) {
+	return std::uniform_real_distribution<float>(min, max)(engine);
+}
+
+veekay::mat4 randomMatrix(std::mt19937& engine) {
+	veekay::mat4 result;
+
+	for (auto& column : result.elements) {
+		for (float& element : column) {
+			element = randomFloat(engine, -1.0f, 1.0f);
+		}
+	}
+
+	return result;
+}
+
+void benchMath(bench::Harness& harness, std::mt19937& engine) {
+	constexpr size_t count = 1024;
+
+	std::vector<veekay::mat4> lhs(count), rhs(count), result(count);
+	std::vector<veekay::vec4> vectors(count), vector_result(count);
+
+	for (size_t i = 0; i < count; ++i) {
+		lhs[i] = randomMatrix(engine);
+		rhs[i] = randomMatrix(engine);
+		vectors[i] = {randomFloat(engine, -1.0f, 1.0f), randomFloat(engine, -1.0f, 1.0f),
+		              randomFloat(engine, -1.0f, 1.0f), 1.0f};
+	}
+
+	harness.run("mat4/multiply", count, [&] {
+		for (size_t i = 0; i < count; ++i) {
+			result[i] = lhs[i] * rhs[i];
+		}
+		bench::keep(result);
+	});
+
+	harness.run("mat4/multiply_vec4", count, [&] {
+		for (size_t i = 0; i < count; ++i) {
+			vector_result[i] = lhs[i] * vectors[i];
+		}
+		bench::keep(vector_result);
+	});
+
+	harness.run("mat4/transpose", count, [&] {
+		for (size_t i = 0; i < count; ++i) {
+			result[i] = veekay::mat4::transpose(lhs[i]);
+		}
+		bench::keep(result);
+	});
+
+	harness.run("vec4/arithmetic", count, [&] {
+		for (size_t i = 0; i < count; ++i) {
+			vector_result[i] = (vectors[i] + vector_result[i]) * vectors[i] - vectors[i];
+		}
+		bench::keep(vector_result);
+	});
+
+	harness.run("mat4/view_projection", 1, [&] {
+		auto view = veekay::mat4::translation({0.0f, 0.5f, 3.0f});
+		auto projection = veekay::mat4::projection(60.0f, 16.0f / 9.0f, 0.01f, 100.0f);
+		auto view_projection = view * projection;
+		bench::keep(view_projection);
+	});
+}
+
+void benchTransforms(bench::Harness& harness, std::mt19937& engine) {
+	veekay::TransformBatch batch;
+	batch.resize(transform_count);
+
+	for (size_t i = 0; i < transform_count; ++i) {
+		batch.set(i,
+		          {randomFloat(engine, -50.0f, 50.0f), randomFloat(engine, -50.0f, 50.0f),
+		           randomFloat(engine, -50.0f, 50.0f)},
+		          {randomFloat(engine, -3.0f, 3.0f), randomFloat(engine, -3.0f, 3.0f),
+		           randomFloat(engine, -3.0f, 3.0f)},
+		          {1.0f, randomFloat(engine, 0.5f, 2.0f), 1.0f});
+	}
+
+	std::vector<veekay::mat4> matrices(transform_count);
+	std::vector<veekay::affine3x4> affine(transform_count);
+
+	harness.run("transform/batch_matrices_100k", transform_count, [&] {
+		batch.computeMatrices(matrices.data());
+		bench::keep(matrices);
+	});
+
+	harness.run("transform/batch_affine_100k", transform_count, [&] {
+		batch.computeAffine(affine.data());
+		bench::keep(affine);
+	});
+
+	// NOTE: Reference: what testbed used to do per model
+	harness.run("transform/scalar_matrices_100k", transform_count, [&] {
+		for (size_t i = 0; i < transform_count; ++i) {
+			auto s = veekay::mat4::scaling({batch.scale_x[i], batch.scale_y[i], batch.scale_z[i]});
+			auto rx = veekay::mat4::rotation({1.0f, 0.0f, 0.0f}, batch.rotation_x[i]);
+			auto ry = veekay::mat4::rotation({0.0f, 1.0f, 0.0f}, batch.rotation_y[i]);
+			auto rz = veekay::mat4::rotation({0.0f, 0.0f, 1.0f}, batch.rotation_z[i]);
+			auto t = veekay::mat4::translation({batch.position_x[i], batch.position_y[i],
+			                                    batch.position_z[i]});
+			matrices[i] = s * rx * ry * rz * t;
+		}
+		bench::keep(matrices);
+	});
+}
+
+void benchUniforms(bench::Harness& harness, std::mt19937& engine) {
+	harness.run("uniforms/structure_alignment", uniform_count, [&] {
+		size_t total = 0;
+		for (size_t i = 0; i < uniform_count; ++i) {
+			total += veekay::graphics::Buffer::structureAlignment(sizeof(ModelUniforms) + (i & 7));
+		}
+		bench::keep(total);
+	});
+
+	auto mapped = std::make_unique<char[]>(uniform_count * uniform_alignment);
+
+	veekay::TransformBatch batch;
+	batch.resize(uniform_count);
+
+	std::vector<LegacyModelUniforms> staged(uniform_count);
+	for (auto& uniforms : staged) {
+		uniforms.model = randomMatrix(engine);
+		uniforms.albedo_color = {1.0f, 0.5f, 0.25f};
+	}
+
+	// NOTE: Build a vector of structures, then copy each one to aligned offset
+	harness.run("uniforms/staged_copy_1k", uniform_count, [&] {
+		for (size_t i = 0; i < uniform_count; ++i) {
+			char* pointer = mapped.get() + i * uniform_alignment;
+			*reinterpret_cast<LegacyModelUniforms*>(pointer) = staged[i];
+		}
+		bench::keep(mapped);
+	});
+
+	// NOTE: Compute transforms directly into mapped memory
+	harness.run("uniforms/direct_affine_1k", uniform_count, [&] {
+		batch.computeAffine(mapped.get(), uniform_alignment);
+		for (size_t i = 0; i < uniform_count; ++i) {
+			char* pointer = mapped.get() + i * uniform_alignment;
+			reinterpret_cast<ModelUniforms*>(pointer)->albedo_color = {1.0f, 0.5f, 0.25f};
+		}
+		bench::keep(mapped);
+	});
+
+	// NOTE: Same, but packed tightly like testbed storage buffer
+	harness.run("uniforms/packed_affine_1k", uniform_count, [&] {
+		batch.computeAffine(mapped.get(), sizeof(ModelUniforms));
+		ModelUniforms* packed = reinterpret_cast<ModelUniforms*>(mapped.get());
+		for (size_t i = 0; i < uniform_count; ++i) {
+			packed[i].albedo_color = {1.0f, 0.5f, 0.25f};
+		}
+		bench::keep(mapped);
+	});
+}
+
+void benchMeshes(bench::Harness& harness) {
+	// NOTE: Generators are constexpr, but here they run at runtime on purpose
+	//       to measure the cost that compile-time generation saves
+	volatile float radius = 0.5f;
+
+	harness.run("mesh/sphere_64x32", 65 * 33, [&] {
+		auto mesh = veekay::geometry::sphere<64, 32>(radius);
+		bench::keep(mesh);
+	});
+
+	harness.run("mesh/torus_64x32", 65 * 33, [&] {
+		auto mesh = veekay::geometry::torus<64, 32>(radius, radius * 0.25f);
+		bench::keep(mesh);
+	});
+
+	harness.run("mesh/cube", 24, [&] {
+		auto mesh = veekay::geometry::cube(radius * 2.0f);
+		bench::keep(mesh);
+	});
+
+	// NOTE: Runtime packing cost, relevant for meshes loaded from files
+	const auto sphere = veekay::geometry::sphere<64, 32>(radius);
+
+	harness.run("mesh/quantize_sphere_64x32", sphere.vertices.size(), [&] {
+		auto mesh = veekay::quantize::mesh(sphere);
+		bench::keep(mesh);
+	});
+}
+
+void printUsage(const char* program) {
+	std::cerr << "Usage: " << program << " [--json FILE] [--filter SUBSTRING]"
+	          << " [--repetitions N] [--warmup N]\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	bench::Options options;
+	const char* json_path = nullptr;
+
+	for (int i = 1; i < argc; ++i) {
+		const bool has_value = i + 1 < argc;
+
+		if (std::strcmp(argv[i], "--json") == 0 && has_value) {
+			json_path = argv[++i];
+		} else if (std::strcmp(argv[i], "--filter") == 0 && has_value) {
+			options.filter = argv[++i];
+		} else if (std::strcmp(argv[i], "--repetitions") == 0 && has_value) {
+			options.repetitions = std::strtoul(argv[++i], nullptr, 10);
+		} else if (std::strcmp(argv[i], "--warmup") == 0 && has_value) {
+			options.warmup = std::strtoul(argv[++i], nullptr, 10);
+		} else {
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	std::mt19937 engine(1337);
+	bench::Harness harness(options);
+
+	benchMath(harness, engine);
+	benchTransforms(harness, engine);
+	benchUniforms(harness, engine);
+	benchMeshes(harness);
+
+	harness.writeTable(std::cout);
+
+	if (json_path) {
+		std::ofstream file(json_path);
+		if (!file) {
+			std::cerr << "Failed to open " << json_path << " for writing\n";
+			return 1;
+		}
+
+		harness.writeJSON(file);
+	}
+
+	return 0;
+}
@@ -1,14 +1,44 @@
 #pragma once
 
+#include <cstddef>
+
 #include <vulkan/vulkan_core.h>
 
 namespace veekay {
 
+// NOTE: Number of frames CPU may record ahead of GPU, resources
+//       written by CPU every frame need this many copies
+constexpr uint32_t max_frames_in_flight = 2;
+
 typedef void (*InitFunc)(VkCommandBuffer);
 typedef void (*ShutdownFunc)();
 typedef void (*UpdateFunc)(double time);
 typedef void (*RenderFunc)(VkCommandBuffer, VkFramebuffer);
 
+// NOTE: Images of current frame for dynamic rendering, see ApplicationInfo::render_dynamic
+struct RenderTarget {
+	VkExtent2D extent;
+
+	// NOTE: Color image comes in UNDEFINED layout,
+	//       render callback has to leave it in "color_final_layout"
+	VkImage color_image;
+	VkImageView color_view;
+	VkImageLayout color_final_layout;
+
+	// NOTE: Same image every frame, it comes in UNDEFINED layout as well.
+	//       Store op is DONT_CARE unless ApplicationInfo::depth keeps contents
+	VkImage depth_image;
+	VkImageView depth_view;
+	VkAttachmentStoreOp depth_store_op;
+};
+
+typedef void (*DynamicRenderFunc)(VkCommandBuffer, const RenderTarget&);
+typedef void (*LateLatchFunc)();
+
+// NOTE: Advances simulation from "time" to "time + dt" and writes
+//       everything rendering needs into "snapshot"
+typedef void (*TickFunc)(double time, double dt, void* snapshot);
+
 struct Application {
 	uint32_t window_width;
 	uint32_t window_height;
@@ -17,18 +47,123 @@ struct Application {
 	VkPhysicalDevice vk_physical_device;
 	VkRenderPass vk_render_pass;
 
+	// NOTE: Attachment formats, dynamic rendering pipelines are
+	//       created with them in VkPipelineRenderingCreateInfoKHR
+	VkFormat vk_color_format;
+	VkFormat vk_depth_format;
+
+	// NOTE: Persisted between runs, pass it to every vkCreateXXXPipelines call
+	VkPipelineCache vk_pipeline_cache;
+
+	// NOTE: Frame in flight slot [0, max_frames_in_flight) of current frame,
+	//       GPU is guaranteed to be done with this slot when update is called
+	uint32_t frame_index;
+
+	// NOTE: Number of current frame, starts at 1 and only grows. GPU sets
+	//       vk_frame_timeline to N once it finishes frame N, so other submissions
+	//       may wait on it or signal it, see also graphics::waitForFrame
+	uint64_t frame_number;
+	VkSemaphore vk_frame_timeline;
+
+	// NOTE: Seconds from the last input poll previous frame used to its
+	//       submission, see ApplicationInfo::late_latch
+	double input_latency;
+
+	// NOTE: Rendering instances recorded last frame and bytes their attachments
+	//       loaded and stored, counted from load and store ops by RenderGraph and
+	//       veekay's own passes. Rendering an application begins itself is not counted
+	uint32_t attachment_passes;
+	VkDeviceSize attachment_traffic;
+
 	bool running;
 };
 
+// NOTE: Depth contents are rarely needed once frame is drawn, then depth never
+//       leaves tile memory of tile-based GPUs, which also back transient images
+//       with lazily allocated memory that is never committed. Elsewhere it still
+//       saves depth writes to memory at the end of rendering
+enum class DepthAttachment : uint32_t {
+	transient, // storeOp DONT_CARE, lazily allocated memory where supported
+	stored,    // storeOp STORE, e.g. to sample depth after app.vk_render_pass
+};
+
+// NOTE: Headless mode renders into offscreen images instead of window swapchain,
+//       so it runs without display, e.g. with lavapipe on build servers.
+//       Callbacks work the same way, window is created on GLFW null platform
+struct HeadlessInfo {
+	bool enabled;
+
+	// NOTE: Zero means default window size
+	uint32_t width;
+	uint32_t height;
+
+	// NOTE: Zero runs until app.running is false
+	uint32_t frames;
+
+	// NOTE: Every capture_interval-th frame is written as PPM image, path is
+	//       a printf-style pattern taking frame number, e.g. "frame_%04u.ppm"
+	const char* capture_path;
+	uint32_t capture_interval;
+};
+
+// NOTE: Simulation ticks at a fixed rate on its own thread instead of once per frame
+//       in update, so heavy simulation and rendering overlap. Tick function owns
+//       simulation state and may use jobs, update and render read snapshots through
+//       veekay::simulation and must not touch that state
+struct SimulationInfo {
+	TickFunc tick;
+
+	// NOTE: Ticks per second, zero means 60
+	uint32_t tick_rate;
+
+	// NOTE: Size of snapshot written by every tick, snapshot buffer
+	//       keeps contents of previous tick and starts zeroed
+	size_t snapshot_size;
+};
+
 struct ApplicationInfo {
 	InitFunc init;
 	ShutdownFunc shutdown;
 	UpdateFunc update;
 	RenderFunc render;
+
+	// NOTE: When set, it is called instead of "render" and frame is recorded with
+	//       vkCmdBeginRenderingKHR, explicit load/store ops and layout transitions.
+	//       No render pass or framebuffers are created, app.vk_render_pass is null
+	DynamicRenderFunc render_dynamic;
+
+	// NOTE: Called right before submission, after input is polled once more.
+	//       Commands are recorded by then, so it may only write host memory this
+	//       frame reads, e.g. camera uniforms in a PerFrameBuffer slot. Input seen
+	//       here is a few milliseconds old instead of most of a frame
+	LateLatchFunc late_latch;
+
+	HeadlessInfo headless;
+
+	// NOTE: Disabled unless "tick" is set
+	SimulationInfo simulation;
+
+	DepthAttachment depth;
+
+	// NOTE: Draws ImGui in a second subpass of app.vk_render_pass instead of
+	//       a separate render pass, which saves loading and storing color image
+	//       once more per frame. Render callback must end the pass with endRenderPass,
+	//       with dynamic rendering it calls renderImGui inside rendering to color image
+	bool integrated_ui;
 };
 
 extern Application app;
 
 int run(const ApplicationInfo& app_info);
 
+// NOTE: Ends app.vk_render_pass in place of vkCmdEndRenderPass, with integrated UI
+//       it moves to UI subpass and draws ImGui there first
+void endRenderPass(VkCommandBuffer cmd);
+
+// NOTE: Draws ImGui with dynamic rendering and integrated UI. Its pipeline is made
+//       for color and depth formats of RenderTarget, so call it inside
+//       vkCmdBeginRenderingKHR with both of them bound, depth is left untouched.
+//       Inside rendering of secondary command buffers record it into one of them
+void renderImGui(VkCommandBuffer cmd);
+
 } // namespace veekay
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+
+#include <veekay/types.hpp>
+
+// NOTE: Procedural mesh generators usable in constant expressions, so that
+//       static geometry is baked into the executable:
+//
+//       constexpr auto cube = veekay::geometry::cube<Vertex>();
+//       new Buffer(sizeof(cube.vertices), cube.vertices.data(), ...);
+//
+//       Any vertex type that can be aggregate-initialized from
+//       {position, normal, uv} may be used. Triangles are wound clockwise
+//       when looking at their front face, which is what testbed pipeline uses
+
+namespace veekay::geometry {
+
+struct Vertex {
+	vec3 position;
+	vec3 normal;
+	vec2 uv;
+};
+
+template <typename V, size_t vertex_count, size_t index_count>
+struct MeshData {
+	std::array<V, vertex_count> vertices;
+	std::array<uint32_t, index_count> indices;
+};
+
+namespace detail {
+
+// NOTE: Emits two triangles for a quad of a (columns + 1) wide vertex grid
+template <size_t N>
+constexpr void gridIndices(std::array<uint32_t, N>& indices,
+                           uint32_t columns, uint32_t rows) {
+	size_t cursor = 0;
+
+	for (uint32_t j = 0; j < rows; ++j) {
+		for (uint32_t i = 0; i < columns; ++i) {
+			const uint32_t a = j * (columns + 1) + i;
+			const uint32_t b = a + 1;
+			const uint32_t c = b + (columns + 1);
+			const uint32_t d = a + (columns + 1);
+
+			indices[cursor++] = a;
+			indices[cursor++] = b;
+			indices[cursor++] = c;
+			indices[cursor++] = c;
+			indices[cursor++] = d;
+			indices[cursor++] = a;
+		}
+	}
+}
+
+} // namespace detail
+
+// NOTE: Axis-aligned cube centered at origin, 4 vertices per face
+template <typename V = Vertex>
+constexpr MeshData<V, 24, 36> cube(float size = 1.0f) {
+	struct Face {
+		vec3 normal;
+		vec3 u;
+		vec3 v;
+	};
+
+	constexpr Face faces[] = {
+		{{0.0f, 0.0f, -1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+		{{1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}},
+		{{0.0f, 0.0f, 1.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+		{{-1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f, 0.0f}},
+		{{0.0f, -1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}},
+		{{0.0f, 1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+	};
+
+	constexpr vec2 corners[] = {
+		{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f},
+	};
+
+	MeshData<V, 24, 36> result{};
+
+	const float half = size * 0.5f;
+
+	for (uint32_t f = 0; f < 6; ++f) {
+		const Face& face = faces[f];
+
+		for (uint32_t c = 0; c < 4; ++c) {
+			const vec2 uv = corners[c];
+
+			const vec3 position = face.normal * half +
+			                      face.u * ((uv.x - 0.5f) * size) +
+			                      face.v * ((uv.y - 0.5f) * size);
+
+			result.vertices[f * 4 + c] = V{position, face.normal, uv};
+		}
+
+		const uint32_t base = f * 4;
+		const uint32_t quad[] = {0, 1, 2, 2, 3, 0};
+
+		for (uint32_t i = 0; i < 6; ++i) {
+			result.indices[f * 6 + i] = base + quad[i];
+		}
+	}
+
+	return result;
+}
+
+// NOTE: Horizontal plane at y = 0 facing -Y (up in Vulkan's clip space),
+//       subdivided into columns x rows quads
+template <uint32_t columns = 1, uint32_t rows = 1, typename V = Vertex>
+constexpr MeshData<V, (columns + 1) * (rows + 1), columns * rows * 6>
+plane(float width = 1.0f, float depth = 1.0f) {
+	static_assert(columns > 0 && rows > 0);
+
+	MeshData<V, (columns + 1) * (rows + 1), columns * rows * 6> result{};
+
+	const vec3 normal = {0.0f, -1.0f, 0.0f};
+
+	for (uint32_t j = 0; j <= rows; ++j) {
+		for (uint32_t i = 0; i <= columns; ++i) {
+			const vec2 uv = {float(i) / float(columns), float(j) / float(rows)};
+
+			const vec3 position = {
+				(uv.x - 0.5f) * width,
+				0.0f,
+				(0.5f - uv.y) * depth,
+			};
+
+			result.vertices[j * (columns + 1) + i] = V{position, normal, uv};
+		}
+	}
+
+	detail::gridIndices(result.indices, columns, rows);
+
+	return result;
+}
+
+// NOTE: UV sphere centered at origin, slices go around Y axis,
+//       stacks go from the upper (-Y) pole to the lower one
+template <uint32_t slices = 32, uint32_t stacks = 16, typename V = Vertex>
+constexpr MeshData<V, (slices + 1) * (stacks + 1), slices * stacks * 6>
+sphere(float radius = 0.5f) {
+	static_assert(slices >= 3 && stacks >= 2);
+
+	MeshData<V, (slices + 1) * (stacks + 1), slices * stacks * 6> result{};
+
+	for (uint32_t j = 0; j <= stacks; ++j) {
+		const float phi = math::pi * float(j) / float(stacks);
+		const float sin_phi = math::sin(phi);
+		const float cos_phi = math::cos(phi);
+
+		for (uint32_t i = 0; i <= slices; ++i) {
+			const float theta = 2.0f * math::pi * float(i) / float(slices);
+
+			const vec3 normal = {
+				sin_phi * math::cos(theta),
+				-cos_phi,
+				sin_phi * math::sin(theta),
+			};
+
+			const vec2 uv = {float(i) / float(slices), float(j) / float(stacks)};
+
+			result.vertices[j * (slices + 1) + i] = V{normal * radius, normal, uv};
+		}
+	}
+
+	detail::gridIndices(result.indices, slices, stacks);
+
+	return result;
+}
+
+// NOTE: Torus lying in XZ plane, rings go around Y axis,
+//       sides go around the tube
+template <uint32_t rings = 32, uint32_t sides = 16, typename V = Vertex>
+constexpr MeshData<V, (rings + 1) * (sides + 1), rings * sides * 6>
+torus(float major_radius = 0.5f, float minor_radius = 0.2f) {
+	static_assert(rings >= 3 && sides >= 3);
+
+	MeshData<V, (rings + 1) * (sides + 1), rings * sides * 6> result{};
+
+	for (uint32_t j = 0; j <= sides; ++j) {
+		const float phi = 2.0f * math::pi * float(j) / float(sides);
+		const float sin_phi = math::sin(phi);
+		const float cos_phi = math::cos(phi);
+
+		for (uint32_t i = 0; i <= rings; ++i) {
+			const float theta = 2.0f * math::pi * float(i) / float(rings);
+			const float sin_theta = math::sin(theta);
+			const float cos_theta = math::cos(theta);
+
+			const vec3 center = {major_radius * cos_theta, 0.0f, major_radius * sin_theta};
+			const vec3 normal = {cos_phi * cos_theta, sin_phi, cos_phi * sin_theta};
+
+			const vec2 uv = {float(i) / float(rings), float(j) / float(sides)};
+
+			result.vertices[j * (rings + 1) + i] = V{center + normal * minor_radius, normal, uv};
+		}
+	}
+
+	detail::gridIndices(result.indices, rings, sides);
+
+	return result;
+}
+
+} // namespace veekay::geometry
@@ -1,21 +1,66 @@
 #pragma once
 
+#include <functional>
+
 #include <vulkan/vulkan_core.h>
 
+#include <veekay/memory.hpp>
+
 namespace veekay::graphics {
 
+enum class MemoryUsage {
+	// NOTE: Device local memory, filled through a staging copy,
+	//       host visible only with resizable BAR or on integrated GPUs
+	gpu_only,
+
+	// NOTE: Host memory written by CPU once and read by GPU, e.g. staging buffers
+	upload,
+
+	// NOTE: Host memory written by GPU and read back by CPU
+	readback,
+
+	// NOTE: Host visible memory rewritten by CPU every frame,
+	//       device local one is preferred when available
+	dynamic,
+};
+
 struct Buffer {
 	VkBuffer buffer;
-	VkDeviceMemory memory;
+	Allocation allocation;
+
+	// NOTE: Null when memory is not host visible
 	void* mapped_region;
 
 	Buffer(size_t size, const void* data,
-	       VkBufferUsageFlags usage);
+	       VkBufferUsageFlags usage,
+	       MemoryUsage memory_usage = MemoryUsage::dynamic);
+
+	// NOTE: Records upload of "data" into cmd, unless memory happens to be
+	//       host visible. Staging memory is released once GPU completes
+	//       the frame cmd is submitted with (or initialization commands)
+	Buffer(VkCommandBuffer cmd,
+	       size_t size, const void* data,
+	       VkBufferUsageFlags usage,
+	       MemoryUsage memory_usage = MemoryUsage::gpu_only);
+
 	~Buffer();
 
 	static size_t structureAlignment(size_t struct_size);
 };
 
+// NOTE: Buffer holding separate copy of data for every frame in flight,
+//       so that CPU writes next frame while GPU still reads previous ones.
+//       Bind with dynamic offsets from offset()
+struct PerFrameBuffer : Buffer {
+	size_t slot_size;
+
+	PerFrameBuffer(size_t size, VkBufferUsageFlags usage);
+
+	// NOTE: Slot of veekay::app.frame_index
+	uint32_t offset() const;
+	void* data() const;
+};
+
 struct Texture {
 	uint32_t width;
 	uint32_t height;
@@ -23,15 +68,31 @@ struct Texture {
 
 	VkImage image;
 	VkImageView view;
-	VkDeviceMemory memory;
-
-	Buffer* staging;
+	Allocation allocation;
 
+	// NOTE: Pixels are uploaded through staging ring on cmd
 	Texture(VkCommandBuffer cmd,
 	        uint32_t width, uint32_t height,
 	        VkFormat format,
 	        const void* pixels);
 	~Texture();
+
+	// NOTE: Staging offset for buffer to image copies, multiple of
+	//       texel size, 4 and optimalBufferCopyOffsetAlignment
+	static VkDeviceSize copyAlignment(VkDeviceSize texel_size);
 };
 
+// NOTE: Number of the latest frame GPU has finished, frames finish in order
+uint64_t completedFrame();
+
+// NOTE: Blocks until GPU finishes frame "frame_number", zero returns immediately
+void waitForFrame(uint64_t frame_number);
+
+// NOTE: Deferred destruction: resource is destroyed after GPU finishes every
+//       frame submitted so far, including the one being recorded, so it is
+//       safe to release resources used by current frame without vkDeviceWaitIdle
+void destroyLater(Buffer* buffer);
+void destroyLater(Texture* texture);
+void destroyLater(std::function<void()> destroy);
+
 } // namespace veekay::graphics
@@ -4,6 +4,9 @@
 
 namespace veekay::input {
 
+// NOTE: Presses and deltas are counted since the start of previous frame, or
+//       inside ApplicationInfo::late_latch since the previous late latch
+
 namespace mouse {
 
 enum class Button {
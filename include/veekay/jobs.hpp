@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace veekay::jobs {
+
+// NOTE: Work-stealing scheduler started by veekay::run. Every worker has its
+//       own deque, it takes newest jobs from it and steals oldest ones from
+//       others when empty. Main thread runs jobs too while it waits
+
+typedef std::function<void()> JobFunc;
+typedef std::function<void(size_t begin, size_t end)> RangeFunc;
+
+struct Job;
+
+// NOTE: Number of unfinished jobs started with it, jobs depending on
+//       a counter start once it drops to zero. Must outlive its jobs
+struct Counter {
+	std::atomic<uint32_t> pending{0};
+
+	// NOTE: Guards dependents and keeps counter alive until last job leaves it
+	std::mutex mutex;
+	std::vector<Job> dependents;
+
+	Counter() = default;
+
+	Counter(const Counter&) = delete;
+	Counter& operator=(const Counter&) = delete;
+};
+
+struct Job {
+	JobFunc function;
+	Counter* counter;
+};
+
+// NOTE: Queues "function", "counter" (if any) is decremented when it finishes.
+//       Safe to call from any thread, including from inside a job
+void run(JobFunc function, Counter* counter = nullptr);
+
+// NOTE: Same, but "function" is queued only once "dependency" drops to zero
+void run(JobFunc function, Counter* counter, Counter& dependency);
+
+// NOTE: Runs queued jobs until "counter" drops to zero, never sleeps,
+//       so jobs may wait on other jobs without deadlocking workers
+void wait(Counter& counter);
+
+// NOTE: Calls "function" for ranges of at least "min_batch" items covering
+//       [0, count) in parallel, returns once all of them are done
+void parallelFor(size_t count, size_t min_batch, const RangeFunc& function);
+
+// NOTE: Workers plus main thread
+uint32_t threadCount();
+
+// NOTE: Workers, main thread and slots for registered threads,
+//       per-thread data indexed by threadIndex() is sized by it
+uint32_t threadSlots();
+
+// NOTE: Index of calling thread in [0, threadSlots()), zero is main thread.
+//       Other threads must call registerThread() before using jobs
+uint32_t threadIndex();
+
+// NOTE: Gives a thread not started by scheduler its own index and deque, so it
+//       may run and wait for jobs. Slot is held until scheduler shuts down
+void registerThread();
+
+} // namespace veekay::jobs
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <ostream>
+
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::graphics {
+
+// NOTE: What an allocation is used for, only affects statistics
+enum class MemoryCategory : uint32_t {
+	other,
+	geometry,   // vertex and index buffers
+	uniform,    // uniform and storage buffers
+	staging,    // upload buffers, including staging ring
+	texture,
+	attachment, // render targets, e.g. depth buffer
+
+	count,
+};
+
+// NOTE: Range of device memory handed out by memory::allocate,
+//       memory is shared with other allocations, so always bind at "offset"
+struct Allocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+
+	// NOTE: Persistently mapped pointer to the range start, null for
+	//       memory that is not host visible
+	void* mapped = nullptr;
+
+	uint32_t memory_type = 0;
+	MemoryCategory category = MemoryCategory::other;
+
+	// NOTE: Allocator bookkeeping
+	uint32_t block = 0;
+	uint32_t order = 0;
+};
+
+struct MemoryBlockStats {
+	uint32_t memory_type;
+	bool linear;
+	bool dedicated;
+
+	VkDeviceSize size;
+	VkDeviceSize used;
+	VkDeviceSize largest_free;
+	uint32_t allocations;
+};
+
+struct MemoryCategoryStats {
+	VkDeviceSize size;
+	uint32_t allocations;
+};
+
+struct MemoryHeapStats {
+	VkDeviceSize size;
+	VkMemoryHeapFlags flags;
+
+	// NOTE: Block memory taken from this heap and part of it handed out
+	VkDeviceSize reserved;
+	VkDeviceSize used;
+
+	// NOTE: Whole process usage and budget reported by VK_EXT_memory_budget,
+	//       without extension these are "reserved" and 80% of heap size
+	VkDeviceSize usage;
+	VkDeviceSize budget;
+};
+
+struct MemoryStats {
+	std::vector<MemoryBlockStats> blocks;
+	std::vector<MemoryHeapStats> heaps;
+
+	// NOTE: Indexed by MemoryCategory, sizes are requested ones without padding
+	std::array<MemoryCategoryStats, size_t(MemoryCategory::count)> categories;
+
+	bool budget_extension;
+
+	// NOTE: Live vkAllocateMemory objects, drivers limit these to a few thousands
+	uint32_t device_allocations;
+	uint32_t allocations;
+
+	VkDeviceSize reserved;
+	VkDeviceSize used;
+
+	// NOTE: 1 - largest free range / free space, summed over blocks,
+	//       0 means every block can fit a request as large as its free space
+	float fragmentation;
+};
+
+namespace memory {
+
+// NOTE: Memory is sub-allocated from large per memory type blocks with a
+//       buddy allocator, requests larger than half a block and lazily allocated
+//       ones get dedicated memory.
+//       Linear resources (buffers) and optimal images never share a block,
+//       so bufferImageGranularity doesn't need to be taken into account
+//
+//       Memory type is picked among requirements.memoryTypeBits having all
+//       "required" flags, types that also have "preferred" flags win
+Allocation allocate(const VkMemoryRequirements& requirements,
+                    VkMemoryPropertyFlags required,
+                    VkMemoryPropertyFlags preferred,
+                    bool linear,
+                    MemoryCategory category = MemoryCategory::other);
+
+void free(const Allocation& allocation);
+
+MemoryStats stats();
+
+const char* categoryName(MemoryCategory category);
+
+// NOTE: Snapshot of stats() for offline analysis
+void writeJson(std::ostream& stream);
+
+// NOTE: ImGui window with heap budgets, categories and blocks,
+//       call between ImGui::NewFrame and ImGui::Render
+void drawImGui(bool* open = nullptr);
+
+const VkPhysicalDeviceMemoryProperties& properties();
+
+} // namespace memory
+
+} // namespace veekay::graphics
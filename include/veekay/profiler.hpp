@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::graphics::profiler {
+
+// NOTE: GPU timestamp profiler. Every frame in flight has its own query pool,
+//       results of a frame are read once GPU finishes it, so nothing stalls.
+//       Numbers lag behind by max_frames_in_flight frames
+//
+//       Scopes nest and may be recorded inside or outside render passes,
+//       "name" must outlive the frame, e.g. be a string literal. Every begin
+//       needs an end on the same command buffer within a frame, debug builds
+//       assert it, elsewhere scopes whose queries never became available are skipped
+
+void begin(VkCommandBuffer cmd, const char* name);
+void end(VkCommandBuffer cmd);
+
+// NOTE: Ends scope at the end of C++ scope, make sure it ends before vkEndCommandBuffer
+struct Scope {
+	VkCommandBuffer cmd;
+
+	Scope(VkCommandBuffer cmd, const char* name) : cmd{cmd} { begin(cmd, name); }
+	~Scope() { end(cmd); }
+
+	Scope(const Scope&) = delete;
+	Scope& operator=(const Scope&) = delete;
+};
+
+struct ScopeStats {
+	std::string name;
+	uint32_t depth;
+
+	// NOTE: Milliseconds, average and extremes are taken over
+	//       a rolling window of recent frames
+	double last;
+	double average;
+	double min;
+	double max;
+	uint32_t samples;
+};
+
+// NOTE: False if graphics queue does not support timestamps
+bool supported();
+
+// NOTE: Scopes of the most recently resolved frame in recording order
+std::vector<ScopeStats> results();
+
+void writeCsv(std::ostream& stream);
+
+// NOTE: ImGui window with rolling averages per scope,
+//       call between ImGui::NewFrame and ImGui::Render
+void drawImGui(bool* open = nullptr);
+
+} // namespace veekay::graphics::profiler
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <bit>
+
+#include <vulkan/vulkan_core.h>
+
+#include <veekay/types.hpp>
+#include <veekay/geometry.hpp>
+
+// NOTE: Compact 16 byte vertex format:
+//       position - R16G16B16A16_UNORM relative to mesh bounds (w is unused)
+//       normal   - R16G16_SNORM octahedral encoding of unit vector
+//       uv       - R16G16_SFLOAT
+//
+//       Positions are decoded in vertex shader as bounds.min + value * bounds.extent,
+//       bounds are passed per mesh through push constants. Everything here is
+//       usable in constant expressions, so baked meshes can be packed at compile time:
+//
+//       constexpr auto cube = veekay::quantize::mesh(veekay::geometry::cube());
+
+namespace veekay::quantize {
+
+struct PackedVertex {
+	uint16_t position[4];
+	int16_t normal[2];
+	uint16_t uv[2];
+};
+
+static_assert(sizeof(PackedVertex) == 16);
+
+// NOTE: Laid out as two std430 vec3's, can be pushed to shaders as is
+struct Bounds {
+	vec3 min; float _pad0;
+	vec3 extent; float _pad1;
+};
+
+template <size_t vertex_count, size_t index_count>
+struct QuantizedMesh {
+	std::array<PackedVertex, vertex_count> vertices;
+	std::array<uint32_t, index_count> indices;
+	Bounds bounds;
+};
+
+namespace detail {
+
+constexpr float abs(float value) { return value < 0.0f ? -value : value; }
+
+constexpr float clamp(float value, float min, float max) {
+	return value < min ? min : (value > max ? max : value);
+}
+
+// NOTE: Sign function that never returns zero, required by octahedral wrapping
+constexpr float signNotZero(float value) { return value < 0.0f ? -1.0f : 1.0f; }
+
+} // namespace detail
+
+// NOTE: IEEE 754 binary16 conversion with round to nearest even,
+//       values out of range become infinities, NaNs stay NaNs
+constexpr uint16_t toHalf(float value) {
+	const uint32_t bits = std::bit_cast<uint32_t>(value);
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	const uint32_t exponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (exponent == 0xff) {
+		return uint16_t(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+	}
+
+	const int32_t half_exponent = int32_t(exponent) - 127 + 15;
+
+	if (half_exponent >= 0x1f) {
+		return uint16_t(sign | 0x7c00);
+	}
+
+	if (half_exponent <= 0) {
+		// NOTE: Result is subnormal or zero
+		if (half_exponent < -10) {
+			return uint16_t(sign);
+		}
+
+		mantissa |= 0x800000;
+
+		const uint32_t shift = uint32_t(14 - half_exponent);
+		const uint32_t halfway = 1u << (shift - 1);
+		const uint32_t remainder = mantissa & ((1u << shift) - 1);
+
+		uint32_t result = mantissa >> shift;
+		if (remainder > halfway || (remainder == halfway && (result & 1))) {
+			++result;
+		}
+
+		return uint16_t(sign | result);
+	}
+
+	// NOTE: Rounding may carry into exponent, which is still correct
+	uint32_t result = (uint32_t(half_exponent) << 10) | (mantissa >> 13);
+	const uint32_t remainder = mantissa & 0x1fff;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (result & 1))) {
+		++result;
+	}
+
+	return uint16_t(sign | result);
+}
+
+constexpr float fromHalf(uint16_t half) {
+	const uint32_t sign = uint32_t(half & 0x8000) << 16;
+	const uint32_t exponent = (half >> 10) & 0x1f;
+	const uint32_t mantissa = half & 0x3ff;
+
+	if (exponent == 0x1f) {
+		return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+	}
+
+	if (exponent == 0) {
+		const float magnitude = float(mantissa) * (1.0f / 16777216.0f);
+		return sign ? -magnitude : magnitude;
+	}
+
+	return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+constexpr uint16_t toUnorm16(float value) {
+	return uint16_t(detail::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+constexpr int16_t toSnorm16(float value) {
+	const float scaled = detail::clamp(value, -1.0f, 1.0f) * 32767.0f;
+	return int16_t(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+}
+
+constexpr float fromUnorm16(uint16_t value) { return float(value) / 65535.0f; }
+
+constexpr float fromSnorm16(int16_t value) {
+	return detail::clamp(float(value) / 32767.0f, -1.0f, 1.0f);
+}
+
+// NOTE: Projects unit vector onto octahedron and unfolds it into [-1, 1] square,
+//       lower hemisphere is folded over the diagonals
+constexpr vec2 octahedralEncode(const vec3& normal) {
+	const float sum = detail::abs(normal.x) + detail::abs(normal.y) + detail::abs(normal.z);
+
+	if (sum == 0.0f) {
+		return {0.0f, 0.0f};
+	}
+
+	vec2 result = {normal.x / sum, normal.y / sum};
+
+	if (normal.z < 0.0f) {
+		result = {
+			(1.0f - detail::abs(result.y)) * detail::signNotZero(result.x),
+			(1.0f - detail::abs(result.x)) * detail::signNotZero(result.y),
+		};
+	}
+
+	return result;
+}
+
+// NOTE: Same decoding as vertex shader does
+constexpr vec3 octahedralDecode(const vec2& encoded) {
+	vec3 result = {
+		encoded.x,
+		encoded.y,
+		1.0f - detail::abs(encoded.x) - detail::abs(encoded.y),
+	};
+
+	const float fold = detail::clamp(-result.z, 0.0f, 1.0f);
+	result.x += result.x >= 0.0f ? -fold : fold;
+	result.y += result.y >= 0.0f ? -fold : fold;
+
+	return vec3::normalized(result);
+}
+
+template <typename V>
+constexpr Bounds computeBounds(const V* vertices, size_t count) {
+	if (count == 0) {
+		return Bounds{};
+	}
+
+	vec3 min = vertices[0].position;
+	vec3 max = vertices[0].position;
+
+	for (size_t i = 1; i < count; ++i) {
+		const vec3& position = vertices[i].position;
+
+		for (int axis = 0; axis < 3; ++axis) {
+			min[axis] = position[axis] < min[axis] ? position[axis] : min[axis];
+			max[axis] = position[axis] > max[axis] ? position[axis] : max[axis];
+		}
+	}
+
+	Bounds result{};
+	result.min = min;
+	result.extent = max - min;
+
+	return result;
+}
+
+constexpr PackedVertex pack(const vec3& position, const vec3& normal,
+                            const vec2& uv, const Bounds& bounds) {
+	PackedVertex result{};
+
+	// NOTE: Flat axes (e.g. plane height) have zero extent and encode as zero
+	for (int axis = 0; axis < 3; ++axis) {
+		const float extent = bounds.extent[axis];
+		const float relative = extent > 0.0f ? (position[axis] - bounds.min[axis]) / extent : 0.0f;
+		result.position[axis] = toUnorm16(relative);
+	}
+
+	result.position[3] = 65535;
+
+	const vec2 encoded = octahedralEncode(normal);
+	result.normal[0] = toSnorm16(encoded.x);
+	result.normal[1] = toSnorm16(encoded.y);
+
+	result.uv[0] = toHalf(uv.x);
+	result.uv[1] = toHalf(uv.y);
+
+	return result;
+}
+
+// NOTE: Reverse of pack, meant for tools and validation rather than rendering
+constexpr geometry::Vertex unpack(const PackedVertex& vertex, const Bounds& bounds) {
+	geometry::Vertex result{};
+
+	for (int axis = 0; axis < 3; ++axis) {
+		result.position[axis] = bounds.min[axis] +
+		                        fromUnorm16(vertex.position[axis]) * bounds.extent[axis];
+	}
+
+	result.normal = octahedralDecode({fromSnorm16(vertex.normal[0]),
+	                                  fromSnorm16(vertex.normal[1])});
+
+	result.uv = {fromHalf(vertex.uv[0]), fromHalf(vertex.uv[1])};
+
+	return result;
+}
+
+// NOTE: Vertex type must have position, normal and uv members
+template <typename V>
+constexpr void pack(const V* vertices, size_t count,
+                    const Bounds& bounds, PackedVertex* result) {
+	for (size_t i = 0; i < count; ++i) {
+		const V& vertex = vertices[i];
+		result[i] = pack(vertex.position, vertex.normal, vertex.uv, bounds);
+	}
+}
+
+template <typename V, size_t vertex_count, size_t index_count>
+constexpr QuantizedMesh<vertex_count, index_count>
+mesh(const geometry::MeshData<V, vertex_count, index_count>& data) {
+	QuantizedMesh<vertex_count, index_count> result{};
+
+	result.bounds = computeBounds(data.vertices.data(), vertex_count);
+	pack(data.vertices.data(), vertex_count, result.bounds, result.vertices.data());
+	result.indices = data.indices;
+
+	return result;
+}
+
+constexpr VkVertexInputBindingDescription bindingDescription(uint32_t binding = 0) {
+	return VkVertexInputBindingDescription{
+		.binding = binding,
+		.stride = sizeof(PackedVertex),
+		.inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+	};
+}
+
+// NOTE: Position, normal and uv at locations first_location + 0, 1, 2
+constexpr std::array<VkVertexInputAttributeDescription, 3>
+attributeDescriptions(uint32_t binding = 0, uint32_t first_location = 0) {
+	return {{
+		{
+			.location = first_location + 0,
+			.binding = binding,
+			.format = VK_FORMAT_R16G16B16A16_UNORM,
+			.offset = offsetof(PackedVertex, position),
+		},
+		{
+			.location = first_location + 1,
+			.binding = binding,
+			.format = VK_FORMAT_R16G16_SNORM,
+			.offset = offsetof(PackedVertex, normal),
+		},
+		{
+			.location = first_location + 2,
+			.binding = binding,
+			.format = VK_FORMAT_R16G16_SFLOAT,
+			.offset = offsetof(PackedVertex, uv),
+		},
+	}};
+}
+
+} // namespace veekay::quantize
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::graphics {
+
+// NOTE: Records items [begin, end) of a draw list into "cmd", which is a secondary
+//       command buffer inheriting app.vk_render_pass or dynamic rendering. No state
+//       is inherited, so pipeline, descriptor sets and buffers have to be bound again
+typedef std::function<void(VkCommandBuffer cmd, size_t begin, size_t end)> RecordFunc;
+
+// NOTE: Splits "count" items into batches of at least "min_batch" items, records
+//       them as jobs and executes results from "cmd" in item order. Must be
+//       called from main thread or a job, inside app.vk_render_pass begun with
+//       VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, "record" is called concurrently
+void recordParallel(VkCommandBuffer cmd, VkFramebuffer framebuffer,
+                    size_t count, const RecordFunc& record,
+                    size_t min_batch = 256);
+
+// NOTE: Same as above inside vkCmdBeginRenderingKHR begun with
+//       VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT, "rendering"
+//       describes its attachment formats
+void recordParallel(VkCommandBuffer cmd, const VkCommandBufferInheritanceRenderingInfoKHR& rendering,
+                    size_t count, const RecordFunc& record,
+                    size_t min_batch = 256);
+
+// NOTE: Threads recording in parallel, including the calling one
+uint32_t recordingThreads();
+
+} // namespace veekay::graphics
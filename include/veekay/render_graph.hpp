@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+#include <veekay/memory.hpp>
+
+namespace veekay::graphics {
+
+// NOTE: Frame graph. Passes are declared once along with images they read and
+//       write, compile() culls passes nothing depends on, works out barriers
+//       and layouts, and lets transient images with disjoint lifetimes share
+//       memory. execute() then records a frame with a single barrier batch
+//       before each pass that needs one
+//
+//       compile() orders passes by images they use, a pass runs after the writes
+//       it reads, otherwise passes keep declaration order. Reading an image that
+//       nothing writes, or passes that wait for each other, throw.
+//       Passes with attachments are recorded inside vkCmdBeginRenderingKHR, so
+//       their pipelines are created with VkPipelineRenderingCreateInfo
+
+typedef uint32_t GraphImage;
+typedef uint32_t GraphPass;
+
+enum class GraphAccess : uint32_t {
+	color_attachment,
+	depth_attachment,
+	depth_read,           // depth test without writing
+	sampled,              // read in fragment shader
+	transfer_source,
+	transfer_destination,
+};
+
+struct GraphImageInfo {
+	VkFormat format;
+
+	// NOTE: Zero means window size
+	uint32_t width;
+	uint32_t height;
+};
+
+struct GraphStats {
+	uint32_t passes;
+	uint32_t culled_passes;
+
+	// NOTE: vkCmdPipelineBarrier calls and image barriers in them per frame
+	uint32_t barrier_batches;
+	uint32_t image_barriers;
+
+	// NOTE: Memory transient images would take on their own and with aliasing
+	VkDeviceSize transient_size;
+	VkDeviceSize aliased_size;
+};
+
+typedef std::function<void(VkCommandBuffer cmd)> GraphPassFunc;
+
+struct RenderGraph {
+	struct Use {
+		GraphImage image;
+		GraphAccess access;
+		bool write;
+
+		bool clear;
+		VkClearValue clear_value;
+	};
+
+	// NOTE: Image state in between passes
+	struct State {
+		VkImageLayout layout;
+		VkPipelineStageFlags write_stages;
+		VkAccessFlags write_access;
+
+		// NOTE: Reads since last write that already waited for it
+		VkPipelineStageFlags read_stages;
+		VkAccessFlags read_access;
+	};
+
+	struct Barrier {
+		GraphImage image;
+		VkImageLayout old_layout;
+		VkImageLayout new_layout;
+		VkAccessFlags src_access;
+		VkAccessFlags dst_access;
+	};
+
+	struct Batch {
+		VkPipelineStageFlags src_stages;
+		VkPipelineStageFlags dst_stages;
+		std::vector<Barrier> barriers;
+	};
+
+	struct Attachment {
+		GraphImage image;
+		VkImageLayout layout;
+		VkAttachmentLoadOp load_op;
+		VkAttachmentStoreOp store_op;
+		VkClearValue clear_value;
+	};
+
+	struct Pass {
+		const char* name;
+		GraphPassFunc function;
+		VkRenderingFlagsKHR rendering_flags;
+		std::vector<Use> uses;
+
+		// NOTE: Filled by compile()
+		bool culled;
+		Batch batch;
+		std::vector<Attachment> color_attachments;
+		bool has_depth;
+		Attachment depth_attachment;
+	};
+
+	struct Image {
+		const char* name;
+		GraphImageInfo info;
+
+		bool imported;
+		VkImageLayout initial_layout;
+		VkImageLayout final_layout;
+
+		VkImage image;
+		VkImageView view;
+		VkImageUsageFlags usage;
+
+		// NOTE: Index into memory_slots, transient images only
+		uint32_t slot;
+		uint32_t first_pass;
+		uint32_t last_pass;
+	};
+
+	// NOTE: Piece of memory shared by transient images
+	struct MemorySlot {
+		Allocation allocation;
+		VkMemoryRequirements requirements;
+		std::vector<GraphImage> images;
+	};
+
+	std::vector<Pass> passes;
+	std::vector<Image> images;
+	std::vector<MemorySlot> memory_slots;
+
+	// NOTE: Transitions imported images into their final layouts
+	Batch final_batch;
+
+	GraphStats stats;
+	bool compiled = false;
+
+	PFN_vkCmdBeginRenderingKHR begin_rendering = nullptr;
+	PFN_vkCmdEndRenderingKHR end_rendering = nullptr;
+
+	RenderGraph() = default;
+	~RenderGraph();
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	// NOTE: Image made by graph, exists only within a frame. Images used only as
+	//       attachments are transient and prefer lazily allocated memory
+	GraphImage createImage(const char* name, const GraphImageInfo& info);
+
+	// NOTE: Image made elsewhere, e.g. swapchain one, setImage binds actual image
+	//       every frame. Contents are loaded only if "initial_layout" isn't UNDEFINED,
+	//       graph leaves it in "final_layout" at the end of a frame. UNDEFINED
+	//       "final_layout" means contents aren't needed after a frame, e.g. for depth
+	GraphImage importImage(const char* name, VkFormat format,
+	                       VkImageLayout initial_layout, VkImageLayout final_layout);
+
+	void setImage(GraphImage image, VkImage handle, VkImageView view,
+	              uint32_t width, uint32_t height);
+
+	// NOTE: Pass is culled unless it writes an imported image or
+	//       an image read by a pass that is not culled. With
+	//       VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT in "rendering_flags"
+	//       pass function records only vkCmdExecuteCommands, e.g. with recordParallel
+	GraphPass addPass(const char* name, GraphPassFunc function,
+	                  VkRenderingFlagsKHR rendering_flags = 0);
+
+	void read(GraphPass pass, GraphImage image, GraphAccess access);
+
+	// NOTE: With "clear" attachment is cleared on load, otherwise previous
+	//       contents are kept when something wrote them before
+	void write(GraphPass pass, GraphImage image, GraphAccess access,
+	           const VkClearValue* clear = nullptr);
+
+	// NOTE: Creates transient images, no passes or images can be added after.
+	//       Passes are reordered, so GraphPass handles are invalid afterwards
+	void compile();
+
+	void execute(VkCommandBuffer cmd);
+
+	// NOTE: Valid after compile() for transient images, e.g. to sample one in later pass
+	VkImageView imageView(GraphImage image) const;
+};
+
+} // namespace veekay::graphics
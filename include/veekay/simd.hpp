@@ -0,0 +1,191 @@
+#pragma once
+
+// NOTE: SIMD backend is chosen at compile time from the target architecture,
+//       define VEEKAY_NO_SIMD to force plain scalar code everywhere
+#if !defined(VEEKAY_NO_SIMD)
+	#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+		#define VEEKAY_SIMD_SSE 1
+		#include <xmmintrin.h>
+
+		#if defined(__AVX__)
+			#define VEEKAY_SIMD_AVX 1
+			#include <immintrin.h>
+		#endif
+	#elif defined(__aarch64__) || defined(_M_ARM64)
+		#define VEEKAY_SIMD_NEON 1
+		#include <arm_neon.h>
+	#endif
+#endif
+
+namespace veekay::simd {
+
+// NOTE: Thin wrappers over 4-wide float registers, operations are
+//       performed in the same order as scalar code to keep results exact
+
+#if defined(VEEKAY_SIMD_SSE)
+
+typedef __m128 f32x4;
+
+inline f32x4 load(const float* pointer) { return _mm_loadu_ps(pointer); }
+inline void store(float* pointer, f32x4 value) { _mm_storeu_ps(pointer, value); }
+inline f32x4 splat(float value) { return _mm_set1_ps(value); }
+inline f32x4 add(f32x4 lhs, f32x4 rhs) { return _mm_add_ps(lhs, rhs); }
+inline f32x4 sub(f32x4 lhs, f32x4 rhs) { return _mm_sub_ps(lhs, rhs); }
+inline f32x4 mul(f32x4 lhs, f32x4 rhs) { return _mm_mul_ps(lhs, rhs); }
+inline f32x4 div(f32x4 lhs, f32x4 rhs) { return _mm_div_ps(lhs, rhs); }
+
+#elif defined(VEEKAY_SIMD_NEON)
+
+typedef float32x4_t f32x4;
+
+inline f32x4 load(const float* pointer) { return vld1q_f32(pointer); }
+inline void store(float* pointer, f32x4 value) { vst1q_f32(pointer, value); }
+inline f32x4 splat(float value) { return vdupq_n_f32(value); }
+inline f32x4 add(f32x4 lhs, f32x4 rhs) { return vaddq_f32(lhs, rhs); }
+inline f32x4 sub(f32x4 lhs, f32x4 rhs) { return vsubq_f32(lhs, rhs); }
+inline f32x4 mul(f32x4 lhs, f32x4 rhs) { return vmulq_f32(lhs, rhs); }
+inline f32x4 div(f32x4 lhs, f32x4 rhs) { return vdivq_f32(lhs, rhs); }
+
+#else
+
+struct f32x4 {
+	float lanes[4];
+};
+
+inline f32x4 load(const float* pointer) {
+	return {{pointer[0], pointer[1], pointer[2], pointer[3]}};
+}
+
+inline void store(float* pointer, f32x4 value) {
+	for (int i = 0; i < 4; ++i) {
+		pointer[i] = value.lanes[i];
+	}
+}
+
+inline f32x4 splat(float value) { return {{value, value, value, value}}; }
+
+inline f32x4 add(f32x4 lhs, f32x4 rhs) {
+	for (int i = 0; i < 4; ++i) { lhs.lanes[i] += rhs.lanes[i]; }
+	return lhs;
+}
+
+inline f32x4 sub(f32x4 lhs, f32x4 rhs) {
+	for (int i = 0; i < 4; ++i) { lhs.lanes[i] -= rhs.lanes[i]; }
+	return lhs;
+}
+
+inline f32x4 mul(f32x4 lhs, f32x4 rhs) {
+	for (int i = 0; i < 4; ++i) { lhs.lanes[i] *= rhs.lanes[i]; }
+	return lhs;
+}
+
+inline f32x4 div(f32x4 lhs, f32x4 rhs) {
+	for (int i = 0; i < 4; ++i) { lhs.lanes[i] /= rhs.lanes[i]; }
+	return lhs;
+}
+
+#endif
+
+// NOTE: Transposes four registers in place, lane i of every input
+//       ends up in register i
+inline void transpose(f32x4& r0, f32x4& r1, f32x4& r2, f32x4& r3) {
+#if defined(VEEKAY_SIMD_SSE)
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+#elif defined(VEEKAY_SIMD_NEON)
+	const float32x4x2_t t01 = vtrnq_f32(r0, r1);
+	const float32x4x2_t t23 = vtrnq_f32(r2, r3);
+
+	r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+	r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+	r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+	r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+#else
+	f32x4* rows[] = {&r0, &r1, &r2, &r3};
+
+	for (int j = 0; j < 4; ++j) {
+		for (int i = j + 1; i < 4; ++i) {
+			float temporary = rows[j]->lanes[i];
+			rows[j]->lanes[i] = rows[i]->lanes[j];
+			rows[i]->lanes[j] = temporary;
+		}
+	}
+#endif
+}
+
+// NOTE: Computes 4x4 matrix product of row-major float arrays,
+//       result[j] = sum(lhs[j][k] * rhs[k]), result may alias neither input
+inline void multiply4x4(const float* lhs, const float* rhs, float* result) {
+#if defined(VEEKAY_SIMD_AVX)
+	const __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(rhs + 0));
+	const __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(rhs + 4));
+	const __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(rhs + 8));
+	const __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(rhs + 12));
+
+	for (int j = 0; j < 4; j += 2) {
+		const __m256 a = _mm256_loadu_ps(lhs + j * 4);
+
+		__m256 r = _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x00), b0);
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x55), b1));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0xaa), b2));
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0xff), b3));
+
+		_mm256_storeu_ps(result + j * 4, r);
+	}
+#else
+	const f32x4 b0 = load(rhs + 0);
+	const f32x4 b1 = load(rhs + 4);
+	const f32x4 b2 = load(rhs + 8);
+	const f32x4 b3 = load(rhs + 12);
+
+	for (int j = 0; j < 4; ++j) {
+		const float* a = lhs + j * 4;
+
+		f32x4 r = mul(splat(a[0]), b0);
+		r = add(r, mul(splat(a[1]), b1));
+		r = add(r, mul(splat(a[2]), b2));
+		r = add(r, mul(splat(a[3]), b3));
+
+		store(result + j * 4, r);
+	}
+#endif
+}
+
+// NOTE: Computes sum(rows[j] * vector[j]) over 4 rows of a 4x4 array
+inline void combine4x4(const float* rows, const float* vector, float* result) {
+	f32x4 r = mul(load(rows + 0), splat(vector[0]));
+	r = add(r, mul(load(rows + 4), splat(vector[1])));
+	r = add(r, mul(load(rows + 8), splat(vector[2])));
+	r = add(r, mul(load(rows + 12), splat(vector[3])));
+	store(result, r);
+}
+
+inline void transpose4x4(const float* matrix, float* result) {
+#if defined(VEEKAY_SIMD_SSE)
+	__m128 r0 = _mm_loadu_ps(matrix + 0);
+	__m128 r1 = _mm_loadu_ps(matrix + 4);
+	__m128 r2 = _mm_loadu_ps(matrix + 8);
+	__m128 r3 = _mm_loadu_ps(matrix + 12);
+
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+	_mm_storeu_ps(result + 0, r0);
+	_mm_storeu_ps(result + 4, r1);
+	_mm_storeu_ps(result + 8, r2);
+	_mm_storeu_ps(result + 12, r3);
+#elif defined(VEEKAY_SIMD_NEON)
+	const float32x4x4_t columns = vld4q_f32(matrix);
+
+	vst1q_f32(result + 0, columns.val[0]);
+	vst1q_f32(result + 4, columns.val[1]);
+	vst1q_f32(result + 8, columns.val[2]);
+	vst1q_f32(result + 12, columns.val[3]);
+#else
+	for (int j = 0; j < 4; ++j) {
+		for (int i = 0; i < 4; ++i) {
+			result[j * 4 + i] = matrix[i * 4 + j];
+		}
+	}
+#endif
+}
+
+} // namespace veekay::simd
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+namespace veekay::simulation {
+
+// NOTE: Fixed timestep simulation on its own thread, see ApplicationInfo::simulation.
+//       Every tick writes a snapshot of what rendering needs, render thread keeps
+//       the two latest ones for a frame and blends them with alpha(). Rendering
+//       thus lags one tick behind simulation, but moves smoothly at any frame rate
+//
+//       Functions below are for render thread, between start of a frame and
+//       its submission. Snapshots are null when simulation is not enabled
+
+// NOTE: Snapshots of two latest ticks, stay unchanged during a frame
+const void* previous();
+const void* current();
+
+// NOTE: Blend factor in [0, 1] from previous to current snapshot for this frame
+float alpha();
+
+// NOTE: Ticks simulated since start
+uint64_t tickCount();
+
+// NOTE: Ticks dropped because simulation could not keep up with real time
+uint64_t skippedTicks();
+
+} // namespace veekay::simulation
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::graphics {
+
+// NOTE: Piece of staging ring, valid until GPU finishes the frame it was allocated in
+struct StagingRange {
+	VkBuffer buffer;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	void* mapped;
+};
+
+namespace staging {
+
+// NOTE: Persistently mapped ring buffer shared by all uploads. Ranges allocated
+//       during a frame are tagged with that frame's number on submission and
+//       recycled once GPU finishes it. When ring is full, allocation waits for the
+//       oldest frame in flight instead of growing
+//
+//       Ring buffer can also be bound directly as vertex, index or uniform
+//       buffer for data that lives only one frame
+
+VkDeviceSize capacity();
+
+// NOTE: Returns false if request does not fit even after all submitted frames retire.
+//       Offset is a multiple of "alignment", which need not be a power of two
+bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment, StagingRange& result);
+
+// NOTE: Same as above, but throws when request does not fit
+StagingRange allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+// NOTE: Copy "data" into ring and record a transfer from it,
+//       synchronization of the destination is up to the caller
+void copyToBuffer(VkCommandBuffer cmd, VkBuffer destination, VkDeviceSize offset,
+                  const void* data, VkDeviceSize size);
+
+// NOTE: Image must be in TRANSFER_DST_OPTIMAL layout, region.bufferOffset is ignored
+//       and set to an offset aligned for "texel_size", see Texture::copyAlignment
+void copyToImage(VkCommandBuffer cmd, VkImage destination, VkBufferImageCopy region,
+                 VkDeviceSize texel_size, const void* data, VkDeviceSize size);
+
+} // namespace staging
+
+} // namespace veekay::graphics
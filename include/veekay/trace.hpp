@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+namespace veekay::trace {
+
+// NOTE: CPU trace markers. Every thread writes finished scopes into its own
+//       ring buffer without locks, only the most recent events are kept.
+//       "name" must outlive the trace, e.g. be a string literal
+
+void begin(const char* name);
+void end();
+
+struct Scope {
+	Scope(const char* name) { begin(name); }
+	~Scope() { end(); }
+
+	Scope(const Scope&) = delete;
+	Scope& operator=(const Scope&) = delete;
+};
+
+// NOTE: Shown as thread name in trace viewers
+void setThreadName(const char* name);
+
+// NOTE: Marks start of a new frame, called by the main loop
+void frameMark();
+
+// NOTE: Recent frame durations in milliseconds, oldest first
+uint32_t frameTimes(float* result, uint32_t capacity);
+
+// NOTE: Chrome trace event format, opens in chrome://tracing and ui.perfetto.dev.
+//       Events overwritten while exporting are left out
+void writeChromeJson(std::ostream& stream);
+
+// NOTE: ImGui window with frame time graph and histogram,
+//       call between ImGui::NewFrame and ImGui::Render
+void drawImGui(bool* open = nullptr);
+
+} // namespace veekay::trace
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <veekay/types.hpp>
+
+namespace veekay {
+
+// NOTE: Many transforms stored as structure of arrays, so that model
+//       matrices of all objects can be computed in one vectorized pass
+//       Rotation is given in radians and applied around X, then Y, then Z
+struct TransformBatch {
+	std::vector<float> position_x, position_y, position_z;
+	std::vector<float> rotation_x, rotation_y, rotation_z;
+	std::vector<float> scale_x, scale_y, scale_z;
+
+	size_t size() const { return position_x.size(); }
+
+	// NOTE: New transforms are identity
+	void resize(size_t count);
+
+	void set(size_t index, const vec3& position, const vec3& rotation, const vec3& scale);
+
+	// NOTE: Writes scaling * rotation * translation matrices of objects
+	//       [first, first + count) to memory, consecutive matrices being
+	//       "stride" bytes apart (e.g. aligned uniform structures)
+	void computeMatrices(size_t first, size_t count, void* result, size_t stride) const;
+
+	void computeMatrices(void* result, size_t stride = sizeof(mat4)) const {
+		computeMatrices(0, size(), result, stride);
+	}
+
+	// NOTE: Same as above, but writes compact affine3x4 transforms
+	void computeAffine(size_t first, size_t count, void* result, size_t stride) const;
+
+	void computeAffine(void* result, size_t stride = sizeof(affine3x4)) const {
+		computeAffine(0, size(), result, stride);
+	}
+};
+
+} // namespace veekay
@@ -2,9 +2,97 @@
 
 #include <cstdint>
 #include <cmath>
+#include <limits>
+#include <type_traits>
+
+#include <veekay/simd.hpp>
 
 namespace veekay {
 
+namespace math {
+
+constexpr float pi = 3.14159265358979323846f;
+
+// NOTE: Functions below are evaluated with series expansions in constant
+//       expressions and forward to <cmath> at runtime
+
+constexpr float sqrt(float value) {
+	if (!std::is_constant_evaluated()) {
+		return std::sqrt(value);
+	}
+
+	if (!(value > 0.0f)) {
+		return value == 0.0f ? 0.0f : std::numeric_limits<float>::quiet_NaN();
+	}
+
+	// NOTE: Newton's method converges monotonically when started from above
+	double result = value > 1.0f ? value : 1.0;
+	for (int i = 0; i < 256; ++i) {
+		double next = 0.5 * (result + value / result);
+		if (next >= result) {
+			break;
+		}
+
+		result = next;
+	}
+
+	return float(result);
+}
+
+// NOTE: Maps angle onto [-pi, pi] for series expansions
+constexpr double reduceAngle(double angle) {
+	constexpr double two_pi = 6.283185307179586476925;
+
+	const double turns = angle / two_pi;
+	const long long whole = static_cast<long long>(turns + (turns >= 0.0 ? 0.5 : -0.5));
+
+	return angle - double(whole) * two_pi;
+}
+
+constexpr float sin(float angle) {
+	if (!std::is_constant_evaluated()) {
+		return std::sin(angle);
+	}
+
+	const double x = reduceAngle(angle);
+
+	double term = x;
+	double result = x;
+	for (int i = 1; i < 14; ++i) {
+		term *= -x * x / double((2 * i) * (2 * i + 1));
+		result += term;
+	}
+
+	return float(result);
+}
+
+constexpr float cos(float angle) {
+	if (!std::is_constant_evaluated()) {
+		return std::cos(angle);
+	}
+
+	const double x = reduceAngle(angle);
+
+	double term = 1.0;
+	double result = 1.0;
+	for (int i = 1; i < 14; ++i) {
+		term *= -x * x / double((2 * i - 1) * (2 * i));
+		result += term;
+	}
+
+	return float(result);
+}
+
+constexpr float tan(float angle) {
+	if (!std::is_constant_evaluated()) {
+		return std::tan(angle);
+	}
+
+	return math::sin(angle) / math::cos(angle);
+}
+
+} // namespace math
+
 union vec2 {
 	struct {
 		float x;
@@ -13,100 +101,121 @@ union vec2 {
 
 	float elements[2];
 
-	vec2& operator+=(const vec2& other) {
+	constexpr vec2& operator+=(const vec2& other) {
 		x += other.x;
 		y += other.y;
 		return *this;
 	}
 
-	vec2& operator+=(float scalar) {
+	constexpr vec2& operator+=(float scalar) {
 		x += scalar;
 		y += scalar;
 		return *this;
 	}
 
-	vec2& operator-=(const vec2& other) {
+	constexpr vec2& operator-=(const vec2& other) {
 		x -= other.x;
 		y -= other.y;
 		return *this;
 	}
 
-	vec2& operator-=(float scalar) {
+	constexpr vec2& operator-=(float scalar) {
 		x -= scalar;
 		y -= scalar;
 		return *this;
 	}
 
-	vec2& operator*=(const vec2& other) {
+	constexpr vec2& operator*=(const vec2& other) {
 		x *= other.x;
 		y *= other.y;
 		return *this;
 	}
 
-	vec2& operator*=(float scalar) {
+	constexpr vec2& operator*=(float scalar) {
 		x *= scalar;
 		y *= scalar;
 		return *this;
 	}
 
-	vec2& operator/=(const vec2& other) {
+	constexpr vec2& operator/=(const vec2& other) {
 		x /= other.x;
 		y /= other.y;
 		return *this;
 	}
 
-	vec2& operator/=(float scalar) {
+	constexpr vec2& operator/=(float scalar) {
 		x /= scalar;
 		y /= scalar;
 		return *this;
 	}
 
-	vec2 operator+(const vec2& other) const {
+	constexpr vec2 operator+(const vec2& other) const {
 		vec2 result = *this;
 		return result += other;
 	}
 
-	vec2 operator+(float scalar) const {
+	constexpr vec2 operator+(float scalar) const {
 		vec2 result = *this;
 		return result += scalar;
 	}
 
-	vec2 operator-(const vec2& other) const {
+	constexpr vec2 operator-(const vec2& other) const {
 		vec2 result = *this;
 		return result -= other;
 	}
 
-	vec2 operator-(float scalar) const {
+	constexpr vec2 operator-(float scalar) const {
 		vec2 result = *this;
 		return result -= scalar;
 	}
 
-	vec2 operator-() const {
+	constexpr vec2 operator-() const {
 		return {-x, -y};
 	}
 
-	vec2 operator*(const vec2& other) const {
+	constexpr vec2 operator*(const vec2& other) const {
 		vec2 result = *this;
 		return result *= other;
 	}
 
-	vec2 operator*(float scalar) const {
+	constexpr vec2 operator*(float scalar) const {
 		vec2 result = *this;
 		return result *= scalar;
 	}
 
-	vec2 operator/(const vec2& other) const {
+	constexpr vec2 operator/(const vec2& other) const {
 		vec2 result = *this;
 		return result /= other;
 	}
 
-	vec2 operator/(float scalar) const {
+	constexpr vec2 operator/(float scalar) const {
 		vec2 result = *this;
 		return result /= scalar;
 	}
 
-	float& operator[](size_t index) { return elements[index]; }
-	const float& operator[](size_t index) const { return elements[index]; }
+	constexpr float& operator[](size_t index) {
+		if (std::is_constant_evaluated()) {
+			// NOTE: Only named components are active in constant expressions
+			switch (index) {
+				case 0: return x;
+				default: return y;
+			}
+		}
+
+		return elements[index];
+	}
+
+	constexpr const float& operator[](size_t index) const {
+		if (std::is_constant_evaluated()) {
+			// NOTE: Only named components are active in constant expressions
+			switch (index) {
+				case 0: return x;
+				default: return y;
+			}
+		}
+
+		return elements[index];
+	}
 };
 
 union vec3 {
@@ -118,117 +227,117 @@ union vec3 {
 
 	float elements[3];
 
-	vec3& operator+=(const vec3& other) {
+	constexpr vec3& operator+=(const vec3& other) {
 		x += other.x;
 		y += other.y;
 		z += other.z;
 		return *this;
 	}
 
-	vec3& operator+=(float scalar) {
+	constexpr vec3& operator+=(float scalar) {
 		x += scalar;
 		y += scalar;
 		z += scalar;
 		return *this;
 	}
 
-	vec3& operator-=(const vec3& other) {
+	constexpr vec3& operator-=(const vec3& other) {
 		x -= other.x;
 		y -= other.y;
 		z -= other.z;
 		return *this;
 	}
 
-	vec3& operator-=(float scalar) {
+	constexpr vec3& operator-=(float scalar) {
 		x -= scalar;
 		y -= scalar;
 		z -= scalar;
 		return *this;
 	}
 
-	vec3& operator*=(const vec3& other) {
+	constexpr vec3& operator*=(const vec3& other) {
 		x *= other.x;
 		y *= other.y;
 		z *= other.z;
 		return *this;
 	}
 
-	vec3& operator*=(float scalar) {
+	constexpr vec3& operator*=(float scalar) {
 		x *= scalar;
 		y *= scalar;
 		z *= scalar;
 		return *this;
 	}
 
-	vec3& operator/=(const vec3& other) {
+	constexpr vec3& operator/=(const vec3& other) {
 		x /= other.x;
 		y /= other.y;
 		z /= other.z;
 		return *this;
 	}
 
-	vec3& operator/=(float scalar) {
+	constexpr vec3& operator/=(float scalar) {
 		x /= scalar;
 		y /= scalar;
 		z /= scalar;
 		return *this;
 	}
 
-	vec3 operator+(const vec3& other) const {
+	constexpr vec3 operator+(const vec3& other) const {
 		vec3 result = *this;
 		return result += other;
 	}
 
-	vec3 operator+(float scalar) const {
+	constexpr vec3 operator+(float scalar) const {
 		vec3 result = *this;
 		return result += scalar;
 	}
 
-	vec3 operator-(const vec3& other) const {
+	constexpr vec3 operator-(const vec3& other) const {
 		vec3 result = *this;
 		return result -= other;
 	}
 
-	vec3 operator-(float scalar) const {
+	constexpr vec3 operator-(float scalar) const {
 		vec3 result = *this;
 		return result -= scalar;
 	}
 
-	vec3 operator-() const { return {-x, -y, -z}; }
+	constexpr vec3 operator-() const { return {-x, -y, -z}; }
 
-	vec3 operator*(const vec3& other) const {
+	constexpr vec3 operator*(const vec3& other) const {
 		vec3 result = *this;
 		return result *= other;
 	}
 
-	vec3 operator*(float scalar) const {
+	constexpr vec3 operator*(float scalar) const {
 		vec3 result = *this;
 		return result *= scalar;
 	}
 
-	vec3 operator/(const vec3& other) const {
+	constexpr vec3 operator/(const vec3& other) const {
 		vec3 result = *this;
 		return result /= other;
 	}
 
-	vec3 operator/(float scalar) const {
+	constexpr vec3 operator/(float scalar) const {
 		vec3 result = *this;
 		return result /= scalar;
 	}
 
-	static float dot(const vec3& lhs, const vec3& rhs) {
+	static constexpr float dot(const vec3& lhs, const vec3& rhs) {
 		return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
 	}
 
-	static float squaredLength(const vec3& vector) {
+	static constexpr float squaredLength(const vec3& vector) {
 		return dot(vector, vector);
 	}
 
-	static float length(const vec3& vector) {
-		return std::sqrt(squaredLength(vector));
+	static constexpr float length(const vec3& vector) {
+		return math::sqrt(squaredLength(vector));
 	}
 
-	static vec3 normalized(const vec3& vector) {
+	static constexpr vec3 normalized(const vec3& vector) {
 		vec3 result = vector;
 
 		float len = length(vector);
@@ -240,7 +349,7 @@ union vec3 {
 		return result;
 	}
 
-	static vec3 cross(const vec3& lhs, const vec3& rhs) {
+	static constexpr vec3 cross(const vec3& lhs, const vec3& rhs) {
 		return {
 			(lhs.y * rhs.z) - (lhs.z * rhs.y),
 			(lhs.z * rhs.x) - (lhs.x * rhs.z),
@@ -248,8 +357,31 @@ union vec3 {
 		};
 	}
 
-	float& operator[](size_t index) { return elements[index]; }
-	const float& operator[](size_t index) const { return elements[index]; }
+	constexpr float& operator[](size_t index) {
+		if (std::is_constant_evaluated()) {
+			// NOTE: Only named components are active in constant expressions
+			switch (index) {
+				case 0: return x;
+				case 1: return y;
+				default: return z;
+			}
+		}
+
+		return elements[index];
+	}
+
+	constexpr const float& operator[](size_t index) const {
+		if (std::is_constant_evaluated()) {
+			// NOTE: Only named components are active in constant expressions
+			switch (index) {
+				case 0: return x;
+				case 1: return y;
+				default: return z;
+			}
+		}
+
+		return elements[index];
+	}
 };
 
 union vec4 {
@@ -262,165 +394,366 @@ union vec4 {
 
 	float elements[4];
 
-	vec4& operator+=(const vec4& other) {
-		x += other.x;
-		y += other.y;
-		z += other.z;
-		w += other.w;
+	constexpr vec4& operator+=(const vec4& other) {
+		if (std::is_constant_evaluated()) {
+			x += other.x;
+			y += other.y;
+			z += other.z;
+			w += other.w;
+		} else {
+			simd::store(elements, simd::add(simd::load(elements), simd::load(other.elements)));
+		}
+
 		return *this;
 	}
 
-	vec4& operator-=(const vec4& other) {
-		x -= other.x;
-		y -= other.y;
-		z -= other.z;
-		w -= other.w;
+	constexpr vec4& operator-=(const vec4& other) {
+		if (std::is_constant_evaluated()) {
+			x -= other.x;
+			y -= other.y;
+			z -= other.z;
+			w -= other.w;
+		} else {
+			simd::store(elements, simd::sub(simd::load(elements), simd::load(other.elements)));
+		}
+
 		return *this;
 	}
 
-	vec4& operator*=(const vec4& other) {
-		x *= other.x;
-		y *= other.y;
-		z *= other.z;
-		w *= other.w;
+	constexpr vec4& operator*=(const vec4& other) {
+		if (std::is_constant_evaluated()) {
+			x *= other.x;
+			y *= other.y;
+			z *= other.z;
+			w *= other.w;
+		} else {
+			simd::store(elements, simd::mul(simd::load(elements), simd::load(other.elements)));
+		}
+
 		return *this;
 	}
 
-	vec4& operator/=(const vec4& other) {
-		x /= other.x;
-		y /= other.y;
-		z /= other.z;
-		w /= other.w;
+	constexpr vec4& operator/=(const vec4& other) {
+		if (std::is_constant_evaluated()) {
+			x /= other.x;
+			y /= other.y;
+			z /= other.z;
+			w /= other.w;
+		} else {
+			simd::store(elements, simd::div(simd::load(elements), simd::load(other.elements)));
+		}
+
 		return *this;
 	}
 
-	vec4 operator+(const vec4& other) const {
+	constexpr vec4 operator+(const vec4& other) const {
 		vec4 result = *this;
 		return result += other;
 	}
 
-	vec4 operator-(const vec4& other) const {
+	constexpr vec4 operator-(const vec4& other) const {
 		vec4 result = *this;
 		return result -= other;
 	}
 
-	vec4 operator*(const vec4& other) const {
+	constexpr vec4 operator*(const vec4& other) const {
 		vec4 result = *this;
 		return result *= other;
 	}
 
-	vec4 operator/(const vec4& other) const {
+	constexpr vec4 operator/(const vec4& other) const {
 		vec4 result = *this;
 		return result /= other;
 	}
 
-	float& operator[](size_t index) { return elements[index]; }
-	const float& operator[](size_t index) const { return elements[index]; }
+	constexpr float& operator[](size_t index) {
+		if (std::is_constant_evaluated()) {
+			// NOTE: Only named components are active in constant expressions
+			switch (index) {
+				case 0: return x;
+				case 1: return y;
+				case 2: return z;
+				default: return w;
+			}
+		}
+
+		return elements[index];
+	}
+
+	constexpr const float& operator[](size_t index) const {
+		if (std::is_constant_evaluated()) {
+			// NOTE: Only named components are active in constant expressions
+			switch (index) {
+				case 0: return x;
+				case 1: return y;
+				case 2: return z;
+				default: return w;
+			}
+		}
+
+		return elements[index];
+	}
+};
+
+// NOTE: Rotation quaternion, (x, y, z) is vector part and w is scalar part
+//       Like with mat4, "lhs * rhs" rotates by lhs first and by rhs second
+union quat {
+	struct {
+		float x;
+		float y;
+		float z;
+		float w;
+	};
+
+	float elements[4];
+
+	static constexpr quat identity() {
+		return {0.0f, 0.0f, 0.0f, 1.0f};
+	}
+
+	// NOTE: Same rotation as mat4::rotation(axis, angle)
+	static constexpr quat axisAngle(vec3 axis, float angle) {
+		axis = vec3::normalized(axis);
+
+		const float sina = math::sin(angle * 0.5f);
+		const float cosa = math::cos(angle * 0.5f);
+
+		return {axis.x * sina, axis.y * sina, axis.z * sina, cosa};
+	}
+
+	// NOTE: Rotation around X, then Y, then Z axis, as in TransformBatch
+	static constexpr quat euler(vec3 angles) {
+		return axisAngle({1.0f, 0.0f, 0.0f}, angles.x) *
+		       axisAngle({0.0f, 1.0f, 0.0f}, angles.y) *
+		       axisAngle({0.0f, 0.0f, 1.0f}, angles.z);
+	}
+
+	static constexpr float dot(const quat& lhs, const quat& rhs) {
+		return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z + lhs.w * rhs.w;
+	}
+
+	static constexpr quat normalized(const quat& rotation) {
+		const float len = math::sqrt(dot(rotation, rotation));
+		return {rotation.x / len, rotation.y / len, rotation.z / len, rotation.w / len};
+	}
+
+	static constexpr quat conjugate(const quat& rotation) {
+		return {-rotation.x, -rotation.y, -rotation.z, rotation.w};
+	}
+
+	static constexpr vec3 rotate(const quat& rotation, const vec3& vector) {
+		const vec3 axis = {rotation.x, rotation.y, rotation.z};
+		const vec3 t = vec3::cross(axis, vector) * 2.0f;
+
+		return vector + t * rotation.w + vec3::cross(axis, t);
+	}
+
+	// NOTE: Hamilton product "rhs * lhs", see composition order note above
+	constexpr quat operator*(const quat& other) const {
+		return {
+			other.w * x + other.x * w + other.y * z - other.z * y,
+			other.w * y - other.x * z + other.y * w + other.z * x,
+			other.w * z + other.x * y - other.y * x + other.z * w,
+			other.w * w - other.x * x - other.y * y - other.z * z,
+		};
+	}
+
+	constexpr quat& operator*=(const quat& other) {
+		return *this = *this * other;
+	}
+
+	constexpr float& operator[](size_t index) {
+		if (std::is_constant_evaluated()) {
+			// NOTE: Only named components are active in constant expressions
+			switch (index) {
+				case 0: return x;
+				case 1: return y;
+				case 2: return z;
+				default: return w;
+			}
+		}
+
+		return elements[index];
+	}
+
+	constexpr const float& operator[](size_t index) const {
+		if (std::is_constant_evaluated()) {
+			// NOTE: Only named components are active in constant expressions
+			switch (index) {
+				case 0: return x;
+				case 1: return y;
+				case 2: return z;
+				default: return w;
+			}
+		}
+
+		return elements[index];
+	}
 };
 
 union mat4 {
 	float elements[4][4];
 	vec4 columns[4];
 
-	static mat4 identity() {
+	// NOTE: Functions below only touch "elements", which is the member
+	//       initialized by "mat4{}", so that they work in constant expressions
+
+	static constexpr mat4 identity() {
 		mat4 result{};
 
-		result[0][0] = 1.0f;
-		result[1][1] = 1.0f;
-		result[2][2] = 1.0f;
-		result[3][3] = 1.0f;
+		result.elements[0][0] = 1.0f;
+		result.elements[1][1] = 1.0f;
+		result.elements[2][2] = 1.0f;
+		result.elements[3][3] = 1.0f;
 		
 		return result;
 	}
 
-	static mat4 translation(vec3 vector) {
+	static constexpr mat4 translation(vec3 vector) {
 		mat4 result = mat4::identity();
 
-		result[3][0] = vector.x;
-		result[3][1] = vector.y;
-		result[3][2] = vector.z;
+		result.elements[3][0] = vector.x;
+		result.elements[3][1] = vector.y;
+		result.elements[3][2] = vector.z;
 
 		return result;
 	}
 
-	static mat4 scaling(vec3 vector) {
+	static constexpr mat4 scaling(vec3 vector) {
 		mat4 result{};
 
-		result[0][0] = vector.x;
-		result[1][1] = vector.y;
-		result[2][2] = vector.z;
-		result[3][3] = 1.0f;
+		result.elements[0][0] = vector.x;
+		result.elements[1][1] = vector.y;
+		result.elements[2][2] = vector.z;
+		result.elements[3][3] = 1.0f;
 
 		return result;
 	}
 
-	static mat4 rotation(vec3 axis, float angle) {
+	static constexpr mat4 rotation(vec3 axis, float angle) {
 		mat4 result{};
 
-		float length = sqrtf(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+		float length = math::sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
 
 		axis.x /= length;
 		axis.y /= length;
 		axis.z /= length;
 
-		float sina = sinf(angle);
-		float cosa = cosf(angle);
+		float sina = math::sin(angle);
+		float cosa = math::cos(angle);
 		float cosv = 1.0f - cosa;
 
-		result[0][0] = (axis.x * axis.x * cosv) + cosa;
-		result[0][1] = (axis.x * axis.y * cosv) + (axis.z * sina);
-		result[0][2] = (axis.x * axis.z * cosv) - (axis.y * sina);
+		result.elements[0][0] = (axis.x * axis.x * cosv) + cosa;
+		result.elements[0][1] = (axis.x * axis.y * cosv) + (axis.z * sina);
+		result.elements[0][2] = (axis.x * axis.z * cosv) - (axis.y * sina);
+
+		result.elements[1][0] = (axis.y * axis.x * cosv) - (axis.z * sina);
+		result.elements[1][1] = (axis.y * axis.y * cosv) + cosa;
+		result.elements[1][2] = (axis.y * axis.z * cosv) + (axis.x * sina);
 
-		result[1][0] = (axis.y * axis.x * cosv) - (axis.z * sina);
-		result[1][1] = (axis.y * axis.y * cosv) + cosa;
-		result[1][2] = (axis.y * axis.z * cosv) + (axis.x * sina);
+		result.elements[2][0] = (axis.z * axis.x * cosv) + (axis.y * sina);
+		result.elements[2][1] = (axis.z * axis.y * cosv) - (axis.x * sina);
+		result.elements[2][2] = (axis.z * axis.z * cosv) + cosa;
 
-		result[2][0] = (axis.z * axis.x * cosv) + (axis.y * sina);
-		result[2][1] = (axis.z * axis.y * cosv) - (axis.x * sina);
-		result[2][2] = (axis.z * axis.z * cosv) + cosa;
+		result.elements[3][3] = 1.0f;
 
-		result[3][3] = 1.0f;
+		return result;
+	}
+
+	// NOTE: Rotation matrix of a unit quaternion
+	static constexpr mat4 rotation(const quat& rotation) {
+		mat4 result{};
+
+		const float xx = rotation.x * rotation.x;
+		const float yy = rotation.y * rotation.y;
+		const float zz = rotation.z * rotation.z;
+		const float xy = rotation.x * rotation.y;
+		const float xz = rotation.x * rotation.z;
+		const float yz = rotation.y * rotation.z;
+		const float wx = rotation.w * rotation.x;
+		const float wy = rotation.w * rotation.y;
+		const float wz = rotation.w * rotation.z;
+
+		result.elements[0][0] = 1.0f - 2.0f * (yy + zz);
+		result.elements[0][1] = 2.0f * (xy + wz);
+		result.elements[0][2] = 2.0f * (xz - wy);
+
+		result.elements[1][0] = 2.0f * (xy - wz);
+		result.elements[1][1] = 1.0f - 2.0f * (xx + zz);
+		result.elements[1][2] = 2.0f * (yz + wx);
+
+		result.elements[2][0] = 2.0f * (xz + wy);
+		result.elements[2][1] = 2.0f * (yz - wx);
+		result.elements[2][2] = 1.0f - 2.0f * (xx + yy);
+
+		result.elements[3][3] = 1.0f;
 
 		return result;
 	}
 
-	static mat4 projection(float fov, float aspect_ratio, float near, float far) {
+	static constexpr mat4 projection(float fov, float aspect_ratio, float near, float far) {
 		mat4 result{};
 
-		const float radians = fov * M_PI / 180.0f;
-		const float cot = 1.0f / tanf(radians / 2.0f);
+		const float radians = fov * math::pi / 180.0f;
+		const float cot = 1.0f / math::tan(radians / 2.0f);
 
-		result[0][0] = cot / aspect_ratio;
-		result[1][1] = cot;
-		result[2][3] = 1.0f;
+		result.elements[0][0] = cot / aspect_ratio;
+		result.elements[1][1] = cot;
+		result.elements[2][3] = 1.0f;
 
-		result[2][2] = far / (far - near);
-		result[3][2] = (-near * far) / (far - near);
+		result.elements[2][2] = far / (far - near);
+		result.elements[3][2] = (-near * far) / (far - near);
 
 		return result;
 	}
 
-	static mat4 transpose(const mat4& matrix) {
+	static constexpr mat4 transpose(const mat4& matrix) {
 		mat4 result{};
 
-		for (int j = 0; j < 4; ++j) {
-			for (int i = 0; i < 4; ++i) {
-				result[j][i] = matrix[i][j];
+		if (std::is_constant_evaluated()) {
+			for (int j = 0; j < 4; ++j) {
+				for (int i = 0; i < 4; ++i) {
+					result.elements[j][i] = matrix.elements[i][j];
+				}
 			}
+		} else {
+			simd::transpose4x4(&matrix.elements[0][0], &result.elements[0][0]);
 		}
 
 		return result;
 	}
 
-	mat4 operator*(const mat4& other) const {
+	constexpr mat4 operator*(const mat4& other) const {
 		mat4 result{};
 
-		for (int j = 0; j < 4; j++) {
-			for (int i = 0; i < 4; i++) {
-				for (int k = 0; k < 4; k++) {
-					result[j][i] += elements[j][k] * other[k][i];
+		if (std::is_constant_evaluated()) {
+			for (int j = 0; j < 4; j++) {
+				for (int i = 0; i < 4; i++) {
+					for (int k = 0; k < 4; k++) {
+						result.elements[j][i] += elements[j][k] * other.elements[k][i];
+					}
 				}
 			}
+		} else {
+			simd::multiply4x4(&elements[0][0], &other.elements[0][0], &result.elements[0][0]);
+		}
+
+		return result;
+	}
+
+	// NOTE: Same as GLSL "matrix * vector", i.e. sum of columns scaled by vector components
+	constexpr vec4 operator*(const vec4& vector) const {
+		vec4 result{};
+
+		if (std::is_constant_evaluated()) {
+			for (size_t j = 0; j < 4; ++j) {
+				result.x += elements[j][0] * vector[j];
+				result.y += elements[j][1] * vector[j];
+				result.z += elements[j][2] * vector[j];
+				result.w += elements[j][3] * vector[j];
+			}
+		} else {
+			simd::combine4x4(&elements[0][0], vector.elements, result.elements);
 		}
 
 		return result;
@@ -430,4 +763,80 @@ union mat4 {
 	const vec4& operator[](size_t index) const { return columns[index]; }
 };
 
+// NOTE: Affine transform with implicit (0, 0, 0, 1) last row, 48 bytes instead
+//       of 64. Stored as three rows of (linear part, translation), which maps
+//       onto std140 GLSL "mat3x4 m" used as "vec4(position, 1.0) * m"
+union affine3x4 {
+	float elements[3][4];
+	vec4 rows[3];
+
+	static constexpr affine3x4 identity() {
+		affine3x4 result{};
+
+		result.elements[0][0] = 1.0f;
+		result.elements[1][1] = 1.0f;
+		result.elements[2][2] = 1.0f;
+
+		return result;
+	}
+
+	// NOTE: Drops projective part of a matrix
+	static constexpr affine3x4 fromMatrix(const mat4& matrix) {
+		affine3x4 result{};
+
+		for (int r = 0; r < 3; ++r) {
+			for (int c = 0; c < 4; ++c) {
+				result.elements[r][c] = matrix.elements[c][r];
+			}
+		}
+
+		return result;
+	}
+
+	// NOTE: Scaling, then rotation, then translation
+	static constexpr affine3x4 compose(vec3 position, const quat& rotation, vec3 scale) {
+		const mat4 linear = mat4::rotation(rotation);
+
+		affine3x4 result{};
+
+		for (int r = 0; r < 3; ++r) {
+			for (int c = 0; c < 3; ++c) {
+				result.elements[r][c] = linear.elements[c][r] * scale[c];
+			}
+
+			result.elements[r][3] = position[r];
+		}
+
+		return result;
+	}
+
+	constexpr mat4 matrix() const {
+		mat4 result{};
+
+		for (int r = 0; r < 3; ++r) {
+			for (int c = 0; c < 4; ++c) {
+				result.elements[c][r] = elements[r][c];
+			}
+		}
+
+		result.elements[3][3] = 1.0f;
+
+		return result;
+	}
+
+	constexpr vec3 transformPoint(const vec3& point) const {
+		vec3 result{};
+
+		for (int r = 0; r < 3; ++r) {
+			result[r] = elements[r][0] * point.x + elements[r][1] * point.y +
+			            elements[r][2] * point.z + elements[r][3];
+		}
+
+		return result;
+	}
+
+	vec4& operator[](size_t index) { return rows[index]; }
+	const vec4& operator[](size_t index) const { return rows[index]; }
+};
+
 } // namespace veekay
@@ -1,6 +1,16 @@
 #pragma once
 
 #include <veekay/types.hpp>
+#include <veekay/transform.hpp>
+#include <veekay/geometry.hpp>
+#include <veekay/quantize.hpp>
 #include <veekay/application.hpp>
 #include <veekay/input.hpp>
 #include <veekay/graphics.hpp>
+#include <veekay/staging.hpp>
+#include <veekay/profiler.hpp>
+#include <veekay/trace.hpp>
+#include <veekay/jobs.hpp>
+#include <veekay/recording.hpp>
+#include <veekay/render_graph.hpp>
+#include <veekay/simulation.hpp>
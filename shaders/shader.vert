@@ -1,29 +1,64 @@
 #version 450
 
-layout (location = 0) in vec3 v_position;
-layout (location = 1) in vec3 v_normal;
+// NOTE: Quantized vertex, see veekay/quantize.hpp
+layout (location = 0) in vec4 v_position; // NOTE: Relative to mesh bounds
+layout (location = 1) in vec2 v_normal; // NOTE: Octahedral encoding
 layout (location = 2) in vec2 v_uv;
 
 layout (location = 0) out vec3 f_position;
 layout (location = 1) out vec3 f_normal;
 layout (location = 2) out vec2 f_uv;
+layout (location = 3) flat out vec3 f_albedo_color;
 
 layout (binding = 0, std140) uniform SceneUniforms {
 	mat4 view_projection;
 };
 
-layout (binding = 1, std140) uniform ModelUniforms {
-	mat4 model;
+// NOTE: Each column of mat3x4 holds one row of affine model transform
+struct ModelUniforms {
+	mat3x4 model;
 	vec3 albedo_color;
 };
 
+// NOTE: Packed 64 bytes apart, draw passes model index as first instance
+layout (binding = 1, std430) readonly buffer Models {
+	ModelUniforms models[];
+};
+
+layout (push_constant) uniform MeshBounds {
+	vec3 bounds_min;
+	vec3 bounds_extent;
+};
+
+vec3 decodeOctahedral(vec2 encoded) {
+	vec3 result = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float fold = clamp(-result.z, 0.0f, 1.0f);
+	result.xy += mix(vec2(fold), vec2(-fold), greaterThanEqual(result.xy, vec2(0.0f)));
+	return normalize(result);
+}
+
 void main() {
-	vec4 position = model * vec4(v_position, 1.0f);
-	vec4 normal = model * vec4(v_normal, 0.0f);
+	mat3x4 model = models[gl_InstanceIndex].model;
+
+	vec3 local_position = bounds_min + v_position.xyz * bounds_extent;
+	vec3 local_normal = decodeOctahedral(v_normal);
+
+	vec3 position = vec4(local_position, 1.0f) * model;
+
+	// NOTE: Rows of cofactor matrix are cross products of linear part rows,
+	//       it is inverse transpose up to a scale, so it handles non-uniform scaling
+	vec3 r0 = model[0].xyz;
+	vec3 r1 = model[1].xyz;
+	vec3 r2 = model[2].xyz;
+
+	vec3 normal = vec3(dot(cross(r1, r2), local_normal),
+	                   dot(cross(r2, r0), local_normal),
+	                   dot(cross(r0, r1), local_normal));
 
-	gl_Position = view_projection * position;
+	gl_Position = view_projection * vec4(position, 1.0f);
 
-	f_position = position.xyz;
-	f_normal = normal.xyz;
+	f_position = position;
+	f_normal = normal;
 	f_uv = v_uv;
+	f_albedo_color = models[gl_InstanceIndex].albedo_color;
 }
@@ -1,25 +1,141 @@
 #include <veekay/graphics.hpp>
 
 #include <stdexcept>
-#include <limits>
 #include <algorithm>
 #include <cmath>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+#include <vector>
 
 #include <veekay/application.hpp>
+#include <veekay/staging.hpp>
 #include <vulkan/vulkan_core.h>
 
 namespace veekay::graphics {
 
+namespace memory {
+
+	void init(bool memory_budget);
+	void shutdown();
+
+} // namespace memory
+
+namespace staging {
+
+	void init();
+	void shutdown();
+	void submitFrame(uint64_t frame_number);
+	void retireFrame(uint64_t completed_frame);
+	void reset();
+
+} // namespace staging
+
 namespace {
 
 	size_t min_uniform_buffer_offset_alignment;
+	VkDeviceSize optimal_buffer_copy_offset_alignment;
+
+	// NOTE: Device has a large host visible device local heap,
+	//       either with resizable BAR or being an integrated GPU
+	bool device_local_host_visible;
+
+	struct Deletions {
+		uint64_t frame_number;
+		std::vector<std::function<void()>> destroys;
+	};
+
+	std::mutex deletion_mutex;
+
+	// NOTE: Deletions requested since previous submission
+	std::vector<std::function<void()>> open_deletions;
+
+	// NOTE: Submitted frames in order, each waits until GPU finishes it
+	std::deque<Deletions> pending_deletions;
+
+	void runDeletions(std::vector<std::function<void()>>& destroys) {
+		for (auto& destroy : destroys) {
+			destroy();
+		}
+	}
+
+	void memoryFlags(MemoryUsage usage,
+	                 VkMemoryPropertyFlags& required,
+	                 VkMemoryPropertyFlags& preferred) {
+		const VkMemoryPropertyFlags host = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+		                                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+		switch (usage) {
+			case MemoryUsage::gpu_only:
+				required = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+				preferred = device_local_host_visible ? host : 0;
+				break;
+
+			case MemoryUsage::upload:
+				required = host;
+				preferred = 0;
+				break;
+
+			case MemoryUsage::readback:
+				required = host;
+				preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+				break;
+
+			case MemoryUsage::dynamic:
+				required = host;
+				preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+				break;
+		}
+	}
+
+	MemoryCategory bufferCategory(VkBufferUsageFlags usage, MemoryUsage memory_usage) {
+		if (memory_usage == MemoryUsage::upload) {
+			return MemoryCategory::staging;
+		}
+
+		if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT)) {
+			return MemoryCategory::geometry;
+		}
+
+		if (usage & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+			return MemoryCategory::uniform;
+		}
+
+		return MemoryCategory::other;
+	}
+
+	// NOTE: Copies data into staging memory
+	StagingRange stage(const void* data, VkDeviceSize size, VkDeviceSize alignment = 16) {
+		StagingRange range;
+
+		if (!staging::tryAllocate(size, alignment, range)) {
+			// NOTE: One-off staging buffer for uploads larger than staging ring
+			Buffer* buffer = new Buffer(size, nullptr, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			                            MemoryUsage::upload);
+			destroyLater(buffer);
+
+			range = StagingRange{
+				.buffer = buffer->buffer,
+				.offset = 0,
+				.size = size,
+				.mapped = buffer->mapped_region,
+			};
+		}
+
+		std::copy(static_cast<const char*>(data),
+		          static_cast<const char*>(data) + size,
+		          static_cast<char*>(range.mapped));
+
+		return range;
+	}
 
 } // namespace
 
 Buffer::Buffer(size_t size, const void* data,
-               VkBufferUsageFlags usage) {
+               VkBufferUsageFlags usage,
+               MemoryUsage memory_usage) {
 	VkDevice& device = veekay::app.vk_device;
-	VkPhysicalDevice& physical_device = veekay::app.vk_physical_device;
 
 	{
 		VkBufferCreateInfo info{
@@ -38,58 +154,110 @@ Buffer::Buffer(size_t size, const void* data,
 		VkMemoryRequirements requirements;
 		vkGetBufferMemoryRequirements(device, buffer, &requirements);
 
-		VkPhysicalDeviceMemoryProperties properties;
-		vkGetPhysicalDeviceMemoryProperties(physical_device, &properties);
+		VkMemoryPropertyFlags required, preferred;
+		memoryFlags(memory_usage, required, preferred);
 
-		const VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-		                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		allocation = memory::allocate(requirements, required, preferred, true,
+		                              bufferCategory(usage, memory_usage));
 
-		uint32_t index = std::numeric_limits<uint32_t>::max();
-		for (uint32_t i = 0; i < properties.memoryTypeCount; ++i) {
-			const VkMemoryType& type = properties.memoryTypes[i];
-
-			if ((requirements.memoryTypeBits & (1 << i)) &&
-			    (type.propertyFlags & flags) == flags) {
-				index = i;
-				break;
-			}
+		if (vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+			memory::free(allocation);
+			throw std::runtime_error("Failed to bind Vulkan buffer memory");
 		}
 
-		if (index == std::numeric_limits<uint32_t>::max()) {
-			throw std::runtime_error("Failed to find required memory type to allocate Vulkan buffer");
+		mapped_region = allocation.mapped;
+	}
+
+	if (data != nullptr) {
+		if (mapped_region == nullptr) {
+			vkDestroyBuffer(device, buffer, nullptr);
+			memory::free(allocation);
+			throw std::runtime_error("Failed to write Vulkan buffer that is not host visible");
 		}
 
-		VkMemoryAllocateInfo info{
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-			.allocationSize = requirements.size,
-			.memoryTypeIndex = index,
-		};
+		std::copy(static_cast<const char*>(data),
+		          static_cast<const char*>(data) + size,
+		          static_cast<char*>(mapped_region));
+	}
+}
 
-		if (vkAllocateMemory(device, &info, nullptr, &memory) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to allocate Vulkan buffer memory");
-		}
+Buffer::Buffer(VkCommandBuffer cmd,
+               size_t size, const void* data,
+               VkBufferUsageFlags usage,
+               MemoryUsage memory_usage)
+: Buffer(size, nullptr, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, memory_usage) {
+	if (data == nullptr) {
+		return;
+	}
 
-		if (vkBindBufferMemory(device, buffer, memory, 0) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to bind Vulkan buffer memory");
-		}
+	// NOTE: Resizable BAR or integrated GPU, no copy is needed
+	if (mapped_region != nullptr) {
+		std::copy(static_cast<const char*>(data),
+		          static_cast<const char*>(data) + size,
+		          static_cast<char*>(mapped_region));
+		return;
+	}
 
-		if (vkMapMemory(device, memory, 0, requirements.size, 0, &mapped_region) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to map Vulkan buffer memory");
-		}
+	const StagingRange range = stage(data, size);
 
-		if (data != nullptr) {
-			std::copy(static_cast<const char*>(data),
-			          static_cast<const char*>(data) + size,
-			          static_cast<char*>(mapped_region));
-		}
+	VkBufferCopy region{
+		.srcOffset = range.offset,
+		.dstOffset = 0,
+		.size = size,
+	};
+
+	vkCmdCopyBuffer(cmd, range.buffer, buffer, 1, &region);
+
+	// NOTE: Make copied data visible to every stage that may consume it
+	VkPipelineStageFlags stages = 0;
+	VkAccessFlags access = 0;
+
+	if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) {
+		stages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+		access |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	}
+
+	if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+		stages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+		access |= VK_ACCESS_INDEX_READ_BIT;
+	}
+
+	if (usage & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+		stages |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+		          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+		          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		access |= VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	}
+
+	if (stages == 0) {
+		stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		access = VK_ACCESS_MEMORY_READ_BIT;
 	}
+
+	VkBufferMemoryBarrier barrier{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = access,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.buffer = buffer,
+		.offset = 0,
+		.size = VK_WHOLE_SIZE,
+	};
+
+	vkCmdPipelineBarrier(cmd,
+	                     VK_PIPELINE_STAGE_TRANSFER_BIT, stages,
+	                     0,
+	                     0, nullptr,
+	                     1, &barrier,
+	                     0, nullptr);
 }
 
 Buffer::~Buffer() {
 	VkDevice& device = veekay::app.vk_device;
 
-	vkFreeMemory(device, memory, nullptr);
 	vkDestroyBuffer(device, buffer, nullptr);
+	memory::free(allocation);
 }
 
 size_t Buffer::structureAlignment(size_t struct_size) {
@@ -99,13 +267,35 @@ size_t Buffer::structureAlignment(size_t struct_size) {
 	                     : struct_size;
 }
 
+VkDeviceSize Texture::copyAlignment(VkDeviceSize texel_size) {
+	// NOTE: Texel sizes like 12 bytes are not powers of two, hence lcm
+	VkDeviceSize result = std::lcm(std::max<VkDeviceSize>(texel_size, 1), VkDeviceSize(4));
+
+	if (optimal_buffer_copy_offset_alignment > 0) {
+		result = std::lcm(result, optimal_buffer_copy_offset_alignment);
+	}
+
+	return result;
+}
+
+PerFrameBuffer::PerFrameBuffer(size_t size, VkBufferUsageFlags usage)
+: Buffer(structureAlignment(size) * max_frames_in_flight, nullptr, usage),
+  slot_size{structureAlignment(size)} {}
+
+uint32_t PerFrameBuffer::offset() const {
+	return uint32_t(slot_size * veekay::app.frame_index);
+}
+
+void* PerFrameBuffer::data() const {
+	return static_cast<char*>(mapped_region) + offset();
+}
+
 Texture::Texture(VkCommandBuffer cmd,
                  uint32_t width, uint32_t height,
                  VkFormat format,
                  const void* pixels)
 : width{width}, height{height}, format{format} {
 	VkDevice& device = veekay::app.vk_device;
-	VkPhysicalDevice& physical_device = veekay::app.vk_physical_device;
 
 	uint32_t mips = 1;
 
@@ -143,37 +333,11 @@ Texture::Texture(VkCommandBuffer cmd,
 		VkMemoryRequirements requirements;
 		vkGetImageMemoryRequirements(device, image, &requirements);
 
-		VkPhysicalDeviceMemoryProperties properties;
-		vkGetPhysicalDeviceMemoryProperties(physical_device, &properties);
-
-		const VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-
-		uint32_t index = std::numeric_limits<uint32_t>::max();
-		for (uint32_t i = 0; i < properties.memoryTypeCount; ++i) {
-			const VkMemoryType& type = properties.memoryTypes[i];
-
-			if ((requirements.memoryTypeBits & (1 << i)) &&
-			    (type.propertyFlags & flags) == flags) {
-				index = i;
-				break;
-			}
-		}
-
-		if (index == std::numeric_limits<uint32_t>::max()) {
-			throw std::runtime_error("Failed to find required memory type to allocate Vulkan buffer");
-		}
+		allocation = memory::allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                              0, false, MemoryCategory::texture);
 
-		VkMemoryAllocateInfo info{
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-			.allocationSize = requirements.size,
-			.memoryTypeIndex = index,
-		};
-
-		if (vkAllocateMemory(device, &info, nullptr, &memory) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to allocate Vulkan image memory");
-		}
-
-		if (vkBindImageMemory(device, image, memory, 0) != VK_SUCCESS) {
+		if (vkBindImageMemory(device, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+			memory::free(allocation);
 			throw std::runtime_error("Failed to bind Vulkan image memory");
 		}
 	}
@@ -225,9 +389,8 @@ Texture::Texture(VkCommandBuffer cmd,
 			break;
 	}
 
-	staging = new Buffer(width * height * bytes_per_pixel,
-	                     pixels,
-	                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	const StagingRange pixels_range = stage(pixels, VkDeviceSize(width) * height * bytes_per_pixel,
+	                                        copyAlignment(bytes_per_pixel));
 
 	VkImageMemoryBarrier undef_to_dst{
 		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
@@ -250,7 +413,7 @@ Texture::Texture(VkCommandBuffer cmd,
 	                     1, &undef_to_dst);
 
 	VkBufferImageCopy copy_info{
-		.bufferOffset = 0,
+		.bufferOffset = pixels_range.offset,
 		.bufferRowLength = 0,
 		.bufferImageHeight = 0,
 
@@ -265,7 +428,7 @@ Texture::Texture(VkCommandBuffer cmd,
 		.imageExtent = {width, height, 1},
 	};
 
-	vkCmdCopyBufferToImage(cmd, staging->buffer, image,
+	vkCmdCopyBufferToImage(cmd, pixels_range.buffer, image,
 	                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 	                       1, &copy_info);
 
@@ -360,14 +523,13 @@ Texture::Texture(VkCommandBuffer cmd,
 Texture::~Texture() {
 	VkDevice& device = veekay::app.vk_device;
 
-	delete staging;
-
-	vkFreeMemory(device, memory, nullptr);
 	vkDestroyImageView(device, view, nullptr);
 	vkDestroyImage(device, image, nullptr);
+	memory::free(allocation);
 }
 
-void init() {
+// NOTE: "memory_budget" tells whether VK_EXT_memory_budget is enabled on device
+void init(bool memory_budget) {
 	VkDevice& device = veekay::app.vk_device;
 	VkPhysicalDevice& physical_device = veekay::app.vk_physical_device;
 
@@ -375,6 +537,132 @@ void init() {
 	vkGetPhysicalDeviceProperties(physical_device, &props);
 
 	min_uniform_buffer_offset_alignment = props.limits.minUniformBufferOffsetAlignment;
+	optimal_buffer_copy_offset_alignment = props.limits.optimalBufferCopyOffsetAlignment;
+
+	memory::init(memory_budget);
+
+	// NOTE: Small host visible device local heap is the legacy 256 MB BAR window,
+	//       it is left for dynamic buffers
+	const VkPhysicalDeviceMemoryProperties& memory_properties = memory::properties();
+	const VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+	                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+	                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	device_local_host_visible = false;
+
+	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i) {
+		const VkMemoryType& type = memory_properties.memoryTypes[i];
+		const VkDeviceSize heap_size = memory_properties.memoryHeaps[type.heapIndex].size;
+
+		if ((type.propertyFlags & flags) == flags && heap_size > (VkDeviceSize(256) << 20)) {
+			device_local_host_visible = true;
+			break;
+		}
+	}
+
+	staging::init();
+}
+
+void destroyLater(Buffer* buffer) {
+	destroyLater([buffer]() { delete buffer; });
+}
+
+void destroyLater(Texture* texture) {
+	destroyLater([texture]() { delete texture; });
+}
+
+void destroyLater(std::function<void()> destroy) {
+	std::lock_guard lock(deletion_mutex);
+	open_deletions.push_back(std::move(destroy));
+}
+
+// NOTE: Called when device is idle, e.g. once commands recorded
+//       during initialization have completed
+void finishUploads() {
+	std::vector<std::function<void()>> destroys;
+
+	// NOTE: Destructors may request more deletions, so lock is not held
+	//       while running them and the queue is drained until empty
+	do {
+		destroys.clear();
+
+		{
+			std::lock_guard lock(deletion_mutex);
+
+			for (Deletions& deletions : pending_deletions) {
+				std::move(deletions.destroys.begin(), deletions.destroys.end(),
+				          std::back_inserter(destroys));
+			}
+
+			std::move(open_deletions.begin(), open_deletions.end(),
+			          std::back_inserter(destroys));
+
+			pending_deletions.clear();
+			open_deletions.clear();
+		}
+
+		runDeletions(destroys);
+	} while (!destroys.empty());
+
+	staging::reset();
+}
+
+uint64_t completedFrame() {
+	uint64_t value = 0;
+	vkGetSemaphoreCounterValue(veekay::app.vk_device, veekay::app.vk_frame_timeline, &value);
+
+	return value;
+}
+
+void waitForFrame(uint64_t frame_number) {
+	VkSemaphoreWaitInfo info{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.semaphoreCount = 1,
+		.pSemaphores = &veekay::app.vk_frame_timeline,
+		.pValues = &frame_number,
+	};
+
+	vkWaitSemaphores(veekay::app.vk_device, &info, UINT64_MAX);
+}
+
+// NOTE: Frame commands were submitted to signal "frame_number"
+void submitFrame(uint64_t frame_number) {
+	staging::submitFrame(frame_number);
+
+	std::lock_guard lock(deletion_mutex);
+
+	if (!open_deletions.empty()) {
+		pending_deletions.push_back(Deletions{frame_number, std::move(open_deletions)});
+		open_deletions.clear();
+	}
+}
+
+// NOTE: GPU has finished every frame up to "completed_frame"
+void retireFrame(uint64_t completed_frame) {
+	staging::retireFrame(completed_frame);
+
+	std::vector<std::function<void()>> destroys;
+
+	{
+		std::lock_guard lock(deletion_mutex);
+
+		// NOTE: Frames complete in submission order
+		while (!pending_deletions.empty() &&
+		       pending_deletions.front().frame_number <= completed_frame) {
+			Deletions& deletions = pending_deletions.front();
+			std::move(deletions.destroys.begin(), deletions.destroys.end(), std::back_inserter(destroys));
+
+			pending_deletions.pop_front();
+		}
+	}
+
+	runDeletions(destroys);
+}
+
+void shutdown() {
+	finishUploads();
+	staging::shutdown();
+	memory::shutdown();
 }
 
 } // namespace veekay::graphics
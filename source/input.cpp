@@ -13,13 +13,40 @@ namespace {
 
 namespace veekay::input {
 
+namespace {
+
+// NOTE: Input as seen by one consumer, either update at the start of a frame or
+//       late latch right before submission. Each counts changes since its own
+//       previous snapshot, so nothing is counted twice or lost between the two
+struct Snapshot {
+	std::bitset<static_cast<size_t>(keyboard::Key::count)> key_states, previous_key_states;
+	std::bitset<static_cast<size_t>(mouse::Button::count)> button_states, previous_button_states;
+
+	vec2 cursor_position;
+	vec2 cursor_delta;
+
+	// NOTE: Scroll since previous snapshot, scroll_delta is what was taken last
+	vec2 pending_scroll;
+	vec2 scroll_delta;
+};
+
+Snapshot frame_snapshot, latch_snapshot;
+
+// NOTE: Set from late latch until the next frame starts
+bool latching;
+
+const Snapshot& snapshot() {
+	return latching ? latch_snapshot : frame_snapshot;
+}
+
+} // namespace
+
 namespace mouse {
 
 namespace {
 
-std::bitset<static_cast<size_t>(mouse::Button::count)> states, cached_states;
-vec2 cursor_position, cached_cursor_position;
-vec2 scroll_delta;
+std::bitset<static_cast<size_t>(mouse::Button::count)> states;
+vec2 cursor_position;
 
 } // namespace
 
@@ -29,7 +56,7 @@ bool isButtonDown(Button button) {
 
 bool isButtonPressed(Button button) {
 	size_t index = static_cast<size_t>(button);
-	return states[index] && !cached_states[index];
+	return snapshot().button_states[index] && !snapshot().previous_button_states[index];
 }
 
 void setCaptured(bool capture) {
@@ -42,11 +69,11 @@ vec2 cursorPosition() {
 }
 
 vec2 cursorDelta() {
-	return cursor_position - cached_cursor_position;
+	return snapshot().cursor_delta;
 }
 
 vec2 scrollDelta() {
-	return scroll_delta;
+	return snapshot().scroll_delta;
 }
 
 } // namespace mouse
@@ -55,7 +82,7 @@ namespace keyboard {
 
 namespace {
 
-std::bitset<static_cast<size_t>(keyboard::Key::count)> states, cached_states;
+std::bitset<static_cast<size_t>(keyboard::Key::count)> states;
 
 } // namespace
 
@@ -65,11 +92,29 @@ bool isKeyDown(Key key) {
 
 bool isKeyPressed(Key key) {
 	size_t index = static_cast<size_t>(key);
-	return states[index] && !cached_states[index];
+	return snapshot().key_states[index] && !snapshot().previous_key_states[index];
 }
 
 } // namespace keyboard
 
+namespace {
+
+void take(Snapshot& target) {
+	target.previous_key_states = target.key_states;
+	target.key_states = keyboard::states;
+
+	target.previous_button_states = target.button_states;
+	target.button_states = mouse::states;
+
+	target.cursor_delta = mouse::cursor_position - target.cursor_position;
+	target.cursor_position = mouse::cursor_position;
+
+	target.scroll_delta = target.pending_scroll;
+	target.pending_scroll = {};
+}
+
+} // namespace
+
 void setup(void* const window_ptr) {
 	window = static_cast<GLFWwindow*>(window_ptr);
 	
@@ -219,17 +264,23 @@ void setup(void* const window_ptr) {
 	});
 
 	glfwSetScrollCallback(window, [](GLFWwindow*, double x, double y) {
-		mouse::scroll_delta.x = float(x);
-		mouse::scroll_delta.y = float(y);
+		const vec2 scroll{float(x), float(y)};
+
+		frame_snapshot.pending_scroll += scroll;
+		latch_snapshot.pending_scroll += scroll;
 	});
 }
 
-void cache() {
-	keyboard::cached_states = keyboard::states;
-	mouse::cached_states = mouse::states;
+// NOTE: Called after events are polled at the start of a frame
+void newFrame() {
+	take(frame_snapshot);
+	latching = false;
+}
 
-	mouse::cached_cursor_position = mouse::cursor_position;
-	mouse::scroll_delta = {};
+// NOTE: Called after events are polled again right before late latch
+void latch() {
+	take(latch_snapshot);
+	latching = true;
 }
 
 } // namespace glint::input
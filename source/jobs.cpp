@@ -0,0 +1,311 @@
+#include <veekay/jobs.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include <veekay/trace.hpp>
+
+namespace veekay::jobs {
+
+namespace {
+
+// NOTE: More batches than threads, so that stealing evens out uneven work
+constexpr size_t batches_per_thread = 4;
+
+// NOTE: Deques reserved for threads started elsewhere, see registerThread()
+constexpr uint32_t max_registered_threads = 4;
+
+// NOTE: Index of threads that neither scheduler started nor registered
+constexpr uint32_t unregistered_index = UINT32_MAX;
+
+// NOTE: Owner pushes and pops at the back, thieves take from the front,
+//       so stolen jobs are the oldest and usually the largest ones
+struct Deque {
+	std::mutex mutex;
+	std::deque<Job> jobs;
+};
+
+// NOTE: Index 0 belongs to main thread, then workers, then registered threads.
+//       Created up front, so that registering never resizes it under other threads
+std::vector<std::unique_ptr<Deque>> deques;
+// NOTE: Main thread plus workers
+uint32_t scheduler_threads;
+std::atomic<uint32_t> registered_threads;
+std::vector<std::thread> workers;
+
+// NOTE: Jobs sitting in deques, sleeping workers are woken when it grows
+std::atomic<uint32_t> queued_jobs;
+std::atomic<uint32_t> sleeping_workers;
+
+std::mutex sleep_mutex;
+std::condition_variable sleep_condition;
+bool stopping;
+
+thread_local uint32_t thread_index = unregistered_index;
+
+void push(Job job) {
+	assert(thread_index != unregistered_index && "Thread must call jobs::registerThread() first");
+
+	{
+		Deque& deque = *deques[thread_index];
+
+		std::lock_guard lock(deque.mutex);
+		deque.jobs.push_back(std::move(job));
+	}
+
+	queued_jobs.fetch_add(1);
+
+	// NOTE: Worker checks queued_jobs after announcing that it sleeps, so
+	//       either it sees the job or we see it and wake it up. Taking mutex
+	//       makes sure it is already waiting, otherwise notification is lost
+	if (sleeping_workers.load() > 0) {
+		{ std::lock_guard lock(sleep_mutex); }
+		sleep_condition.notify_one();
+	}
+}
+
+bool pop(Job& result) {
+	assert(thread_index != unregistered_index && "Thread must call jobs::registerThread() first");
+
+	const uint32_t count = uint32_t(deques.size());
+
+	for (uint32_t i = 0; i < count; ++i) {
+		Deque& deque = *deques[(thread_index + i) % count];
+
+		std::lock_guard lock(deque.mutex);
+
+		if (deque.jobs.empty()) {
+			continue;
+		}
+
+		if (i == 0) {
+			result = std::move(deque.jobs.back());
+			deque.jobs.pop_back();
+		} else {
+			result = std::move(deque.jobs.front());
+			deque.jobs.pop_front();
+		}
+
+		queued_jobs.fetch_sub(1);
+		return true;
+	}
+
+	return false;
+}
+
+void finish(Counter& counter) {
+	std::vector<Job> ready;
+
+	{
+		std::lock_guard lock(counter.mutex);
+
+		if (counter.pending.fetch_sub(1) == 1) {
+			ready.swap(counter.dependents);
+		}
+	}
+
+	for (Job& job : ready) {
+		push(std::move(job));
+	}
+}
+
+void execute(Job& job) {
+	job.function();
+
+	if (job.counter) {
+		finish(*job.counter);
+	}
+}
+
+void workerLoop(uint32_t index) {
+	thread_index = index;
+	trace::setThreadName("Job worker");
+
+	for (;;) {
+		Job job;
+
+		if (pop(job)) {
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock lock(sleep_mutex);
+
+		sleeping_workers.fetch_add(1);
+		sleep_condition.wait(lock, [] { return stopping || queued_jobs.load() > 0; });
+		sleeping_workers.fetch_sub(1);
+
+		if (stopping && queued_jobs.load() == 0) {
+			return;
+		}
+	}
+}
+
+} // namespace
+
+void run(JobFunc function, Counter* counter) {
+	if (counter) {
+		counter->pending.fetch_add(1);
+	}
+
+	Job job{std::move(function), counter};
+
+	// NOTE: Scheduler is not running, e.g. outside of veekay::run
+	if (deques.empty()) {
+		execute(job);
+		return;
+	}
+
+	push(std::move(job));
+}
+
+void run(JobFunc function, Counter* counter, Counter& dependency) {
+	if (counter) {
+		counter->pending.fetch_add(1);
+	}
+
+	Job job{std::move(function), counter};
+
+	{
+		std::lock_guard lock(dependency.mutex);
+
+		if (dependency.pending.load() != 0) {
+			dependency.dependents.push_back(std::move(job));
+			return;
+		}
+	}
+
+	if (deques.empty()) {
+		execute(job);
+		return;
+	}
+
+	push(std::move(job));
+}
+
+void wait(Counter& counter) {
+	while (counter.pending.load() != 0) {
+		Job job;
+
+		if (!deques.empty() && pop(job)) {
+			execute(job);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+
+	// NOTE: Job that finished last may still hold the mutex,
+	//       counter must not be destroyed until it lets go
+	std::lock_guard lock(counter.mutex);
+}
+
+void parallelFor(size_t count, size_t min_batch, const RangeFunc& function) {
+	if (count == 0) {
+		return;
+	}
+
+	min_batch = std::max<size_t>(min_batch, 1);
+
+	const size_t batch_count = std::min(threadCount() * batches_per_thread,
+	                                    (count + min_batch - 1) / min_batch);
+
+	if (batch_count <= 1) {
+		function(0, count);
+		return;
+	}
+
+	// NOTE: Batches are as even as possible, first ones get one item more
+	const size_t size = count / batch_count;
+	const size_t remainder = count % batch_count;
+
+	auto batch = [&](size_t index) {
+		const size_t begin = index * size + std::min(index, remainder);
+		function(begin, begin + size + (index < remainder ? 1 : 0));
+	};
+
+	Counter counter;
+
+	for (size_t i = 1; i < batch_count; ++i) {
+		run([&batch, i] { batch(i); }, &counter);
+	}
+
+	batch(0);
+
+	wait(counter);
+}
+
+// NOTE: Registered threads only help while they wait, so they are not counted
+uint32_t threadCount() {
+	return deques.empty() ? 1 : scheduler_threads;
+}
+
+uint32_t threadSlots() {
+	return std::max<uint32_t>(uint32_t(deques.size()), 1);
+}
+
+uint32_t threadIndex() {
+	assert(thread_index != unregistered_index && "Thread must call jobs::registerThread() first");
+	return thread_index;
+}
+
+void registerThread() {
+	// NOTE: Scheduler is not running, jobs run on calling thread anyway
+	if (deques.empty()) {
+		return;
+	}
+
+	const uint32_t slot = registered_threads.fetch_add(1);
+
+	if (slot >= max_registered_threads) {
+		throw std::runtime_error("Too many threads registered with job system");
+	}
+
+	thread_index = scheduler_threads + slot;
+}
+
+void init() {
+	scheduler_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	for (uint32_t i = 0; i < scheduler_threads + max_registered_threads; ++i) {
+		deques.push_back(std::make_unique<Deque>());
+	}
+
+	thread_index = 0;
+	registered_threads = 0;
+	stopping = false;
+
+	for (uint32_t i = 1; i < scheduler_threads; ++i) {
+		workers.emplace_back(workerLoop, i);
+	}
+}
+
+// NOTE: Jobs still queued are finished first
+void shutdown() {
+	{
+		std::lock_guard lock(sleep_mutex);
+		stopping = true;
+	}
+
+	sleep_condition.notify_all();
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	workers.clear();
+
+	// NOTE: Without workers nobody else runs them
+	Job job;
+	while (pop(job)) {
+		execute(job);
+	}
+
+	deques.clear();
+}
+
+} // namespace veekay::jobs
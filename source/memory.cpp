@@ -0,0 +1,554 @@
+#include <veekay/memory.hpp>
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <mutex>
+#include <set>
+
+#include <veekay/application.hpp>
+#include <vulkan/vulkan_core.h>
+#include <imgui.h>
+
+namespace veekay::graphics::memory {
+
+namespace {
+
+constexpr VkDeviceSize default_block_size = VkDeviceSize(64) << 20;
+constexpr VkDeviceSize min_block_size = VkDeviceSize(4) << 20;
+
+// NOTE: Smallest buddy, also covers common uniform buffer alignments
+constexpr VkDeviceSize min_allocation_size = 256;
+
+struct Block {
+	VkDeviceMemory memory;
+	VkDeviceSize size;
+	void* mapped;
+
+	uint32_t memory_type;
+	bool linear;
+	bool dedicated;
+
+	VkDeviceSize used;
+	uint32_t allocations;
+
+	// NOTE: free_lists[order] holds offsets of free ranges
+	//       min_allocation_size << order bytes long
+	std::vector<std::set<VkDeviceSize>> free_lists;
+};
+
+std::mutex mutex;
+
+VkPhysicalDeviceMemoryProperties memory_properties;
+
+// NOTE: VK_EXT_memory_budget is enabled on device
+bool budget_extension;
+
+std::array<MemoryCategoryStats, size_t(MemoryCategory::count)> category_stats;
+
+// NOTE: Slots with null memory are unused and get reused by new blocks,
+//       so that block indices stored in allocations stay valid
+std::vector<Block> blocks;
+
+uint32_t orderOf(VkDeviceSize size) {
+	uint32_t order = 0;
+	while ((min_allocation_size << order) < size) {
+		++order;
+	}
+
+	return order;
+}
+
+VkDeviceSize blockSize(uint32_t memory_type) {
+	const uint32_t heap = memory_properties.memoryTypes[memory_type].heapIndex;
+	const VkDeviceSize heap_size = memory_properties.memoryHeaps[heap].size;
+
+	// NOTE: Small heaps (e.g. 256 MB BAR window) get smaller blocks
+	VkDeviceSize size = default_block_size;
+	while (size > min_block_size && size > heap_size / 8) {
+		size /= 2;
+	}
+
+	return size;
+}
+
+uint32_t findMemoryType(uint32_t type_bits,
+                        VkMemoryPropertyFlags required,
+                        VkMemoryPropertyFlags preferred) {
+	const VkMemoryPropertyFlags flags[] = {required | preferred, required};
+
+	for (VkMemoryPropertyFlags wanted : flags) {
+		for (uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i) {
+			const VkMemoryType& type = memory_properties.memoryTypes[i];
+
+			if ((type_bits & (1 << i)) && (type.propertyFlags & wanted) == wanted) {
+				return i;
+			}
+		}
+	}
+
+	return std::numeric_limits<uint32_t>::max();
+}
+
+uint32_t createBlock(VkDeviceSize size, uint32_t memory_type, bool linear, bool dedicated) {
+	VkDevice& device = veekay::app.vk_device;
+
+	Block block{
+		.size = size,
+		.mapped = nullptr,
+		.memory_type = memory_type,
+		.linear = linear,
+		.dedicated = dedicated,
+		.used = 0,
+		.allocations = 0,
+	};
+
+	{
+		VkMemoryAllocateInfo info{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+			.allocationSize = size,
+			.memoryTypeIndex = memory_type,
+		};
+
+		if (vkAllocateMemory(device, &info, nullptr, &block.memory) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate Vulkan device memory block");
+		}
+	}
+
+	const VkMemoryPropertyFlags flags = memory_properties.memoryTypes[memory_type].propertyFlags;
+
+	if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		if (vkMapMemory(device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped) != VK_SUCCESS) {
+			vkFreeMemory(device, block.memory, nullptr);
+			throw std::runtime_error("Failed to map Vulkan device memory block");
+		}
+	}
+
+	if (!dedicated) {
+		const uint32_t top = orderOf(size);
+		block.free_lists.resize(top + 1);
+		block.free_lists[top].insert(0);
+	}
+
+	for (uint32_t i = 0, n = uint32_t(blocks.size()); i < n; ++i) {
+		if (blocks[i].memory == VK_NULL_HANDLE) {
+			blocks[i] = std::move(block);
+			return i;
+		}
+	}
+
+	blocks.push_back(std::move(block));
+	return uint32_t(blocks.size() - 1);
+}
+
+void destroyBlock(Block& block) {
+	// NOTE: Freeing memory unmaps it implicitly
+	vkFreeMemory(veekay::app.vk_device, block.memory, nullptr);
+
+	block = Block{};
+}
+
+bool allocateFromBlock(Block& block, uint32_t order, VkDeviceSize& offset) {
+	uint32_t current = order;
+	while (current < block.free_lists.size() && block.free_lists[current].empty()) {
+		++current;
+	}
+
+	if (current >= block.free_lists.size()) {
+		return false;
+	}
+
+	auto& list = block.free_lists[current];
+	offset = *list.begin();
+	list.erase(list.begin());
+
+	// NOTE: Split larger range, upper halves go to free lists
+	while (current > order) {
+		--current;
+		block.free_lists[current].insert(offset + (min_allocation_size << current));
+	}
+
+	return true;
+}
+
+void freeToBlock(Block& block, VkDeviceSize offset, uint32_t order) {
+	// NOTE: Merge with free buddies as long as possible
+	while (order + 1 < block.free_lists.size()) {
+		const VkDeviceSize buddy = offset ^ (min_allocation_size << order);
+
+		auto& list = block.free_lists[order];
+		auto it = list.find(buddy);
+		if (it == list.end()) {
+			break;
+		}
+
+		list.erase(it);
+		offset = std::min(offset, buddy);
+		++order;
+	}
+
+	block.free_lists[order].insert(offset);
+}
+
+// NOTE: One empty block per memory type stays around, so that freeing and
+//       creating a resource every frame does not allocate device memory every
+//       time. Further empty blocks of the same kind are given back to the driver
+void releaseEmptyBlock(uint32_t index) {
+	const Block& empty = blocks[index];
+
+	for (uint32_t i = 0, n = uint32_t(blocks.size()); i < n; ++i) {
+		const Block& block = blocks[i];
+
+		if (i != index && block.memory != VK_NULL_HANDLE && !block.dedicated &&
+		    block.allocations == 0 && block.memory_type == empty.memory_type &&
+		    block.linear == empty.linear) {
+			destroyBlock(blocks[index]);
+			return;
+		}
+	}
+}
+
+VkDeviceSize largestFree(const Block& block) {
+	for (size_t order = block.free_lists.size(); order-- > 0;) {
+		if (!block.free_lists[order].empty()) {
+			return min_allocation_size << order;
+		}
+	}
+
+	return 0;
+}
+
+} // namespace
+
+void init(bool memory_budget) {
+	vkGetPhysicalDeviceMemoryProperties(veekay::app.vk_physical_device, &memory_properties);
+
+	budget_extension = memory_budget;
+	category_stats = {};
+}
+
+// NOTE: Allocations that are still alive are released with their blocks
+void shutdown() {
+	std::lock_guard lock(mutex);
+
+	for (Block& block : blocks) {
+		if (block.memory != VK_NULL_HANDLE) {
+			destroyBlock(block);
+		}
+	}
+
+	blocks.clear();
+}
+
+const VkPhysicalDeviceMemoryProperties& properties() {
+	return memory_properties;
+}
+
+Allocation allocate(const VkMemoryRequirements& requirements,
+                    VkMemoryPropertyFlags required,
+                    VkMemoryPropertyFlags preferred,
+                    bool linear,
+                    MemoryCategory category) {
+	const uint32_t memory_type = findMemoryType(requirements.memoryTypeBits, required, preferred);
+	if (memory_type == std::numeric_limits<uint32_t>::max()) {
+		throw std::runtime_error("Failed to find required memory type to allocate Vulkan memory");
+	}
+
+	std::lock_guard lock(mutex);
+
+	const VkDeviceSize block_size = blockSize(memory_type);
+
+	// NOTE: Buddies are aligned to their size, so alignment is
+	//       satisfied by rounding size up to it
+	const VkDeviceSize size = std::max(requirements.size, requirements.alignment);
+
+	Allocation result{
+		.size = requirements.size,
+		.memory_type = memory_type,
+		.category = category,
+	};
+
+	MemoryCategoryStats& category_entry = category_stats[size_t(category)];
+
+	// NOTE: Lazily allocated memory is committed per allocation as tiles need it,
+	//       so it is never shared with other allocations
+	const bool lazy = memory_properties.memoryTypes[memory_type].propertyFlags &
+	                  VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+
+	if (size > block_size / 2 || lazy) {
+		result.block = createBlock(requirements.size, memory_type, linear, true);
+
+		Block& block = blocks[result.block];
+		block.used = requirements.size;
+		block.allocations = 1;
+
+		result.memory = block.memory;
+		result.mapped = block.mapped;
+
+		category_entry.size += result.size;
+		category_entry.allocations += 1;
+
+		return result;
+	}
+
+	result.order = orderOf(size);
+	result.block = std::numeric_limits<uint32_t>::max();
+
+	for (uint32_t i = 0, n = uint32_t(blocks.size()); i < n; ++i) {
+		Block& block = blocks[i];
+
+		if (block.memory == VK_NULL_HANDLE || block.dedicated ||
+		    block.memory_type != memory_type || block.linear != linear) {
+			continue;
+		}
+
+		if (allocateFromBlock(block, result.order, result.offset)) {
+			result.block = i;
+			break;
+		}
+	}
+
+	if (result.block == std::numeric_limits<uint32_t>::max()) {
+		result.block = createBlock(block_size, memory_type, linear, false);
+		allocateFromBlock(blocks[result.block], result.order, result.offset);
+	}
+
+	Block& block = blocks[result.block];
+	block.used += min_allocation_size << result.order;
+	block.allocations += 1;
+
+	result.memory = block.memory;
+	result.mapped = block.mapped ? static_cast<char*>(block.mapped) + result.offset : nullptr;
+
+	category_entry.size += result.size;
+	category_entry.allocations += 1;
+
+	return result;
+}
+
+void free(const Allocation& allocation) {
+	if (allocation.memory == VK_NULL_HANDLE) {
+		return;
+	}
+
+	std::lock_guard lock(mutex);
+
+	MemoryCategoryStats& category_entry = category_stats[size_t(allocation.category)];
+	category_entry.size -= allocation.size;
+	category_entry.allocations -= 1;
+
+	Block& block = blocks[allocation.block];
+
+	if (block.dedicated) {
+		destroyBlock(block);
+		return;
+	}
+
+	freeToBlock(block, allocation.offset, allocation.order);
+	block.used -= min_allocation_size << allocation.order;
+	block.allocations -= 1;
+
+	if (block.allocations == 0) {
+		releaseEmptyBlock(allocation.block);
+	}
+}
+
+MemoryStats stats() {
+	std::lock_guard lock(mutex);
+
+	MemoryStats result{};
+
+	result.categories = category_stats;
+	result.budget_extension = budget_extension;
+
+	result.heaps.resize(memory_properties.memoryHeapCount);
+
+	for (uint32_t i = 0; i < memory_properties.memoryHeapCount; ++i) {
+		result.heaps[i] = MemoryHeapStats{
+			.size = memory_properties.memoryHeaps[i].size,
+			.flags = memory_properties.memoryHeaps[i].flags,
+		};
+	}
+
+	VkDeviceSize free_total = 0;
+	VkDeviceSize largest_total = 0;
+
+	for (const Block& block : blocks) {
+		if (block.memory == VK_NULL_HANDLE) {
+			continue;
+		}
+
+		const MemoryBlockStats block_stats{
+			.memory_type = block.memory_type,
+			.linear = block.linear,
+			.dedicated = block.dedicated,
+			.size = block.size,
+			.used = block.used,
+			.largest_free = block.dedicated ? 0 : largestFree(block),
+			.allocations = block.allocations,
+		};
+
+		result.blocks.push_back(block_stats);
+
+		result.device_allocations += 1;
+		result.allocations += block.allocations;
+		result.reserved += block.size;
+		result.used += block.used;
+
+		MemoryHeapStats& heap = result.heaps[memory_properties.memoryTypes[block.memory_type].heapIndex];
+		heap.reserved += block.size;
+		heap.used += block.used;
+
+		free_total += block.size - block.used;
+		largest_total += block_stats.largest_free;
+	}
+
+	result.fragmentation = free_total > 0 ? 1.0f - float(largest_total) / float(free_total) : 0.0f;
+
+	if (budget_extension) {
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+		};
+
+		VkPhysicalDeviceMemoryProperties2 properties{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+			.pNext = &budget,
+		};
+
+		vkGetPhysicalDeviceMemoryProperties2(veekay::app.vk_physical_device, &properties);
+
+		for (size_t i = 0; i < result.heaps.size(); ++i) {
+			result.heaps[i].usage = budget.heapUsage[i];
+			result.heaps[i].budget = budget.heapBudget[i];
+		}
+	} else {
+		for (MemoryHeapStats& heap : result.heaps) {
+			heap.usage = heap.reserved;
+			heap.budget = heap.size / 10 * 8;
+		}
+	}
+
+	return result;
+}
+
+const char* categoryName(MemoryCategory category) {
+	switch (category) {
+		case MemoryCategory::other: return "other";
+		case MemoryCategory::geometry: return "geometry";
+		case MemoryCategory::uniform: return "uniform";
+		case MemoryCategory::staging: return "staging";
+		case MemoryCategory::texture: return "texture";
+		case MemoryCategory::attachment: return "attachment";
+		case MemoryCategory::count: break;
+	}
+
+	return "unknown";
+}
+
+void writeJson(std::ostream& stream) {
+	const MemoryStats snapshot = stats();
+
+	stream << "{\n";
+	stream << "\t\"budget_extension\": " << (snapshot.budget_extension ? "true" : "false") << ",\n";
+	stream << "\t\"device_allocations\": " << snapshot.device_allocations << ",\n";
+	stream << "\t\"allocations\": " << snapshot.allocations << ",\n";
+	stream << "\t\"reserved\": " << snapshot.reserved << ",\n";
+	stream << "\t\"used\": " << snapshot.used << ",\n";
+	stream << "\t\"fragmentation\": " << snapshot.fragmentation << ",\n";
+
+	stream << "\t\"heaps\": [\n";
+	for (size_t i = 0; i < snapshot.heaps.size(); ++i) {
+		const MemoryHeapStats& heap = snapshot.heaps[i];
+
+		stream << "\t\t{\"index\": " << i
+		       << ", \"device_local\": " << ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "true" : "false")
+		       << ", \"size\": " << heap.size
+		       << ", \"reserved\": " << heap.reserved
+		       << ", \"used\": " << heap.used
+		       << ", \"usage\": " << heap.usage
+		       << ", \"budget\": " << heap.budget
+		       << (i + 1 < snapshot.heaps.size() ? "},\n" : "}\n");
+	}
+	stream << "\t],\n";
+
+	stream << "\t\"categories\": {\n";
+	for (size_t i = 0; i < snapshot.categories.size(); ++i) {
+		const MemoryCategoryStats& category = snapshot.categories[i];
+
+		stream << "\t\t\"" << categoryName(MemoryCategory(i)) << "\": {"
+		       << "\"size\": " << category.size
+		       << ", \"allocations\": " << category.allocations
+		       << (i + 1 < snapshot.categories.size() ? "},\n" : "}\n");
+	}
+	stream << "\t},\n";
+
+	stream << "\t\"blocks\": [\n";
+	for (size_t i = 0; i < snapshot.blocks.size(); ++i) {
+		const MemoryBlockStats& block = snapshot.blocks[i];
+
+		stream << "\t\t{\"memory_type\": " << block.memory_type
+		       << ", \"linear\": " << (block.linear ? "true" : "false")
+		       << ", \"dedicated\": " << (block.dedicated ? "true" : "false")
+		       << ", \"size\": " << block.size
+		       << ", \"used\": " << block.used
+		       << ", \"largest_free\": " << block.largest_free
+		       << ", \"allocations\": " << block.allocations
+		       << (i + 1 < snapshot.blocks.size() ? "},\n" : "}\n");
+	}
+	stream << "\t]\n";
+
+	stream << "}\n";
+}
+
+void drawImGui(bool* open) {
+	if (!ImGui::Begin("Memory", open)) {
+		ImGui::End();
+		return;
+	}
+
+	const MemoryStats snapshot = stats();
+
+	constexpr float mib = 1024.0f * 1024.0f;
+
+	ImGui::Text("%u allocations in %u device allocations",
+	            snapshot.allocations, snapshot.device_allocations);
+	ImGui::Text("%.1f / %.1f MiB used, fragmentation %.2f",
+	            snapshot.used / mib, snapshot.reserved / mib, snapshot.fragmentation);
+
+	ImGui::SeparatorText(snapshot.budget_extension ? "Heaps (VK_EXT_memory_budget)" : "Heaps (estimated)");
+
+	for (size_t i = 0; i < snapshot.heaps.size(); ++i) {
+		const MemoryHeapStats& heap = snapshot.heaps[i];
+
+		char overlay[64];
+		snprintf(overlay, sizeof(overlay), "%.1f / %.1f MiB", heap.usage / mib, heap.budget / mib);
+
+		ImGui::Text("Heap %zu%s", i, (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : "");
+		ImGui::ProgressBar(heap.budget > 0 ? float(heap.usage) / float(heap.budget) : 0.0f,
+		                   ImVec2(-1.0f, 0.0f), overlay);
+	}
+
+	ImGui::SeparatorText("Categories");
+
+	for (size_t i = 0; i < snapshot.categories.size(); ++i) {
+		const MemoryCategoryStats& category = snapshot.categories[i];
+
+		ImGui::Text("%-10s %8.2f MiB in %u", categoryName(MemoryCategory(i)),
+		            category.size / mib, category.allocations);
+	}
+
+	if (ImGui::CollapsingHeader("Blocks")) {
+		for (const MemoryBlockStats& block : snapshot.blocks) {
+			ImGui::Text("type %u %s%s %.1f / %.1f MiB, %u allocations",
+			            block.memory_type,
+			            block.linear ? "linear" : "optimal",
+			            block.dedicated ? " dedicated" : "",
+			            block.used / mib, block.size / mib, block.allocations);
+		}
+	}
+
+	ImGui::End();
+}
+
+} // namespace veekay::graphics::memory
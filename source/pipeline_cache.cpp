@@ -0,0 +1,208 @@
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <veekay/application.hpp>
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::graphics::pipeline_cache {
+
+namespace {
+
+constexpr uint32_t file_magic = 0x4350'4B56; // "VKPC"
+constexpr uint32_t file_version = 1;
+
+// NOTE: Precedes driver's cache data on disk, Vulkan's own header does not
+//       include driver version, and a truncated write must not reach the driver
+struct FileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vendor_id;
+	uint32_t device_id;
+	uint32_t driver_version;
+	uint32_t reserved;
+	uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+	uint64_t data_size;
+	uint64_t data_hash;
+};
+
+uint64_t hash(const uint8_t* data, size_t size) {
+	// NOTE: FNV-1a
+	uint64_t result = 0xcbf2'9ce4'8422'2325;
+
+	for (size_t i = 0; i < size; ++i) {
+		result = (result ^ data[i]) * 0x100'0000'01b3;
+	}
+
+	return result;
+}
+
+FileHeader expectedHeader() {
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(veekay::app.vk_physical_device, &props);
+
+	FileHeader header{
+		.magic = file_magic,
+		.version = file_version,
+		.vendor_id = props.vendorID,
+		.device_id = props.deviceID,
+		.driver_version = props.driverVersion,
+	};
+
+	std::memcpy(header.pipeline_cache_uuid, props.pipelineCacheUUID, VK_UUID_SIZE);
+
+	return header;
+}
+
+// NOTE: Returns reason data is rejected or null if it is usable
+const char* validate(const std::vector<uint8_t>& file) {
+	if (file.size() < sizeof(FileHeader)) {
+		return "file is truncated";
+	}
+
+	FileHeader header;
+	std::memcpy(&header, file.data(), sizeof(header));
+
+	const FileHeader expected = expectedHeader();
+
+	if (header.magic != expected.magic || header.version != expected.version) {
+		return "unknown file format";
+	}
+
+	if (header.vendor_id != expected.vendor_id || header.device_id != expected.device_id) {
+		return "cache was made on another device";
+	}
+
+	if (header.driver_version != expected.driver_version ||
+	    std::memcmp(header.pipeline_cache_uuid, expected.pipeline_cache_uuid, VK_UUID_SIZE) != 0) {
+		return "cache was made by another driver version";
+	}
+
+	const uint8_t* data = file.data() + sizeof(FileHeader);
+
+	if (header.data_size != file.size() - sizeof(FileHeader) ||
+	    header.data_hash != hash(data, header.data_size)) {
+		return "data is corrupted";
+	}
+
+	VkPipelineCacheHeaderVersionOne vk_header;
+	if (header.data_size < sizeof(vk_header)) {
+		return "data is truncated";
+	}
+
+	std::memcpy(&vk_header, data, sizeof(vk_header));
+
+	if (vk_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+	    vk_header.vendorID != expected.vendor_id || vk_header.deviceID != expected.device_id ||
+	    std::memcmp(vk_header.pipelineCacheUUID, expected.pipeline_cache_uuid, VK_UUID_SIZE) != 0) {
+		return "driver header does not match device";
+	}
+
+	return nullptr;
+}
+
+} // namespace
+
+// NOTE: Never fails because of the file, unusable data gives an empty cache
+VkPipelineCache load(const char* path) {
+	std::vector<uint8_t> file;
+
+	{
+		std::ifstream stream(path, std::ios::binary);
+		if (stream) {
+			file.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		}
+	}
+
+	VkPipelineCacheCreateInfo info{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+	};
+
+	if (file.empty()) {
+		std::cout << "Pipeline cache: " << path << " not found, starting empty\n";
+	} else if (const char* reason = validate(file)) {
+		std::cout << "Pipeline cache: " << path << " rejected, " << reason << '\n';
+	} else {
+		info.initialDataSize = file.size() - sizeof(FileHeader);
+		info.pInitialData = file.data() + sizeof(FileHeader);
+
+		std::cout << "Pipeline cache: loaded " << info.initialDataSize << " bytes from " << path << '\n';
+	}
+
+	VkPipelineCache cache = VK_NULL_HANDLE;
+
+	if (vkCreatePipelineCache(veekay::app.vk_device, &info, nullptr, &cache) != VK_SUCCESS) {
+		// NOTE: Driver may still refuse data, retry without it
+		info.initialDataSize = 0;
+		info.pInitialData = nullptr;
+
+		if (vkCreatePipelineCache(veekay::app.vk_device, &info, nullptr, &cache) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan pipeline cache\n";
+			return VK_NULL_HANDLE;
+		}
+	}
+
+	return cache;
+}
+
+// NOTE: Written to a temporary file first, so that a crash
+//       in the middle never leaves a broken cache behind
+void save(VkPipelineCache cache, const char* path) {
+	if (cache == VK_NULL_HANDLE) {
+		return;
+	}
+
+	VkDevice& device = veekay::app.vk_device;
+
+	size_t size = 0;
+	if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS || size == 0) {
+		return;
+	}
+
+	std::vector<uint8_t> data(size);
+	if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS) {
+		return;
+	}
+
+	data.resize(size);
+
+	FileHeader header = expectedHeader();
+	header.data_size = data.size();
+	header.data_hash = hash(data.data(), data.size());
+
+	const std::string temporary_path = std::string(path) + ".tmp";
+
+	{
+		std::ofstream stream(temporary_path, std::ios::binary | std::ios::trunc);
+
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+		// NOTE: Closed before checking, so that errors while flushing count too
+		stream.close();
+
+		if (!stream) {
+			std::cerr << "Failed to write pipeline cache to " << temporary_path << '\n';
+			return;
+		}
+	}
+
+	// NOTE: rename replaces existing file atomically on POSIX, Windows refuses to
+#ifdef _WIN32
+	std::remove(path);
+#endif
+
+	if (std::rename(temporary_path.c_str(), path) != 0) {
+		std::cerr << "Failed to replace pipeline cache " << path << '\n';
+		return;
+	}
+
+	std::cout << "Pipeline cache: saved " << data.size() << " bytes to " << path << '\n';
+}
+
+} // namespace veekay::graphics::pipeline_cache
@@ -0,0 +1,309 @@
+#include <veekay/profiler.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+
+#include <veekay/application.hpp>
+#include <vulkan/vulkan_core.h>
+#include <imgui.h>
+
+namespace veekay::graphics::profiler {
+
+namespace {
+
+// NOTE: Two queries per scope
+constexpr uint32_t max_queries = 512;
+constexpr uint32_t invalid_query = UINT32_MAX;
+
+// NOTE: Frames averaged per scope
+constexpr uint32_t history_size = 120;
+
+struct Record {
+	const char* name;
+	VkCommandBuffer cmd;
+	uint32_t depth;
+	uint32_t begin_query;
+	uint32_t end_query;
+};
+
+struct Frame {
+	VkQueryPool pool;
+	uint32_t used_queries;
+
+	std::vector<Record> records;
+
+	// NOTE: Indices of records not yet ended, scopes nest per command buffer
+	std::vector<uint32_t> open;
+};
+
+struct History {
+	double values[history_size];
+	uint32_t count;
+	uint32_t next;
+};
+
+std::mutex mutex;
+
+bool timestamps_supported;
+
+// NOTE: Nanoseconds per timestamp tick
+double timestamp_period;
+uint64_t timestamp_mask;
+
+Frame frames[max_frames_in_flight];
+
+std::unordered_map<std::string, History> histories;
+std::vector<ScopeStats> last_results;
+
+// NOTE: Query result followed by its availability, see VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
+struct QueryResult {
+	uint64_t timestamp;
+	uint64_t available;
+};
+
+void resolve(const Frame& frame, const std::vector<QueryResult>& queries) {
+	last_results.clear();
+
+	for (const Record& record : frame.records) {
+		if (record.begin_query == invalid_query || record.end_query == invalid_query) {
+			continue;
+		}
+
+		// NOTE: Scope that was never ended, or recorded into a command
+		//       buffer that was not submitted, is left out
+		const QueryResult& begin = queries[record.begin_query];
+		const QueryResult& end = queries[record.end_query];
+
+		if (!begin.available || !end.available) {
+			continue;
+		}
+
+		const uint64_t ticks = (end.timestamp - begin.timestamp) & timestamp_mask;
+		const double ms = double(ticks) * timestamp_period * 1e-6;
+
+		History& history = histories[record.name];
+		history.values[history.next] = ms;
+		history.next = (history.next + 1) % history_size;
+		history.count = std::min(history.count + 1, history_size);
+
+		ScopeStats stats{
+			.name = record.name,
+			.depth = record.depth,
+			.last = ms,
+			.average = 0.0,
+			.min = ms,
+			.max = ms,
+			.samples = history.count,
+		};
+
+		for (uint32_t i = 0; i < history.count; ++i) {
+			stats.average += history.values[i];
+			stats.min = std::min(stats.min, history.values[i]);
+			stats.max = std::max(stats.max, history.values[i]);
+		}
+
+		stats.average /= history.count;
+
+		last_results.push_back(std::move(stats));
+	}
+}
+
+} // namespace
+
+void init(uint32_t queue_family) {
+	VkDevice& device = veekay::app.vk_device;
+	VkPhysicalDevice& physical_device = veekay::app.vk_physical_device;
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(physical_device, &props);
+
+	timestamp_period = props.limits.timestampPeriod;
+
+	uint32_t family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, nullptr);
+
+	std::vector<VkQueueFamilyProperties> families(family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, families.data());
+
+	const uint32_t valid_bits = families[queue_family].timestampValidBits;
+
+	timestamps_supported = valid_bits > 0;
+	timestamp_mask = valid_bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << valid_bits) - 1;
+
+	if (!timestamps_supported) {
+		return;
+	}
+
+	for (Frame& frame : frames) {
+		VkQueryPoolCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount = max_queries,
+		};
+
+		if (vkCreateQueryPool(device, &info, nullptr, &frame.pool) != VK_SUCCESS) {
+			timestamps_supported = false;
+			return;
+		}
+
+		vkResetQueryPool(device, frame.pool, 0, max_queries);
+		frame.used_queries = 0;
+	}
+}
+
+void shutdown() {
+	for (Frame& frame : frames) {
+		vkDestroyQueryPool(veekay::app.vk_device, frame.pool, nullptr);
+		frame = Frame{};
+	}
+
+	histories.clear();
+	last_results.clear();
+}
+
+// NOTE: Called once GPU finishes previous frame of app.frame_index slot, before recording into it
+void newFrame() {
+	if (!timestamps_supported) {
+		return;
+	}
+
+	std::lock_guard lock(mutex);
+
+	Frame& frame = frames[veekay::app.frame_index];
+
+	// NOTE: Every begin needs an end in the same frame
+	assert(frame.open.empty() && "profiler::begin without matching profiler::end");
+
+	if (frame.used_queries > 0) {
+		std::vector<QueryResult> queries(frame.used_queries);
+
+		// NOTE: Unavailable queries make it return VK_NOT_READY,
+		//       available ones are still written and resolved
+		VkResult result = vkGetQueryPoolResults(veekay::app.vk_device, frame.pool,
+		                                        0, frame.used_queries,
+		                                        queries.size() * sizeof(QueryResult), queries.data(),
+		                                        sizeof(QueryResult),
+		                                        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		if (result == VK_SUCCESS || result == VK_NOT_READY) {
+			resolve(frame, queries);
+		}
+
+		vkResetQueryPool(veekay::app.vk_device, frame.pool, 0, frame.used_queries);
+	}
+
+	frame.used_queries = 0;
+	frame.records.clear();
+	frame.open.clear();
+}
+
+bool supported() {
+	return timestamps_supported;
+}
+
+void begin(VkCommandBuffer cmd, const char* name) {
+	if (!timestamps_supported) {
+		return;
+	}
+
+	std::lock_guard lock(mutex);
+
+	Frame& frame = frames[veekay::app.frame_index];
+
+	Record record{
+		.name = name,
+		.cmd = cmd,
+		.depth = 0,
+		.begin_query = invalid_query,
+		.end_query = invalid_query,
+	};
+
+	for (uint32_t index : frame.open) {
+		if (frame.records[index].cmd == cmd) {
+			++record.depth;
+		}
+	}
+
+	// NOTE: Scopes beyond query pool capacity are silently dropped
+	if (frame.used_queries + 2 <= max_queries) {
+		record.begin_query = frame.used_queries;
+		record.end_query = frame.used_queries + 1;
+		frame.used_queries += 2;
+
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, record.begin_query);
+	}
+
+	frame.open.push_back(uint32_t(frame.records.size()));
+	frame.records.push_back(record);
+}
+
+void end(VkCommandBuffer cmd) {
+	if (!timestamps_supported) {
+		return;
+	}
+
+	std::lock_guard lock(mutex);
+
+	Frame& frame = frames[veekay::app.frame_index];
+
+	auto it = std::find_if(frame.open.rbegin(), frame.open.rend(),
+	                       [&](uint32_t index) { return frame.records[index].cmd == cmd; });
+
+	assert(it != frame.open.rend() && "profiler::end without matching profiler::begin");
+
+	if (it == frame.open.rend()) {
+		return;
+	}
+
+	const Record& record = frame.records[*it];
+	frame.open.erase(std::next(it).base());
+
+	if (record.end_query != invalid_query) {
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.pool, record.end_query);
+	}
+}
+
+std::vector<ScopeStats> results() {
+	std::lock_guard lock(mutex);
+	return last_results;
+}
+
+void writeCsv(std::ostream& stream) {
+	stream << "scope,depth,last_ms,average_ms,min_ms,max_ms,samples\n";
+
+	for (const ScopeStats& stats : results()) {
+		stream << stats.name << ',' << stats.depth << ','
+		       << stats.last << ',' << stats.average << ','
+		       << stats.min << ',' << stats.max << ','
+		       << stats.samples << '\n';
+	}
+}
+
+void drawImGui(bool* open) {
+	if (!ImGui::Begin("GPU profiler", open)) {
+		ImGui::End();
+		return;
+	}
+
+	if (!timestamps_supported) {
+		ImGui::Text("Graphics queue does not support timestamps");
+		ImGui::End();
+		return;
+	}
+
+	ImGui::Text("%-24s %8s %8s %8s", "Scope", "last", "average", "max");
+	ImGui::Separator();
+
+	for (const ScopeStats& stats : results()) {
+		ImGui::Text("%*s%-*s %8.3f %8.3f %8.3f",
+		            int(stats.depth * 2), "", int(24 - std::min(stats.depth * 2, 24u)),
+		            stats.name.c_str(), stats.last, stats.average, stats.max);
+	}
+
+	ImGui::End();
+}
+
+} // namespace veekay::graphics::profiler
@@ -0,0 +1,192 @@
+#include <veekay/recording.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <veekay/application.hpp>
+#include <veekay/jobs.hpp>
+#include <veekay/trace.hpp>
+
+namespace veekay::graphics {
+
+namespace {
+
+// NOTE: Caps secondary command buffers executed per call
+constexpr size_t max_batches = 64;
+
+// NOTE: Command pools are externally synchronized, so every job system thread
+//       records from its own pools, one per frame slot to reset once GPU is done with it
+struct ThreadPools {
+	VkCommandPool pools[max_frames_in_flight];
+
+	// NOTE: Secondary buffers are kept between frames, used[slot] of them are in use
+	std::vector<VkCommandBuffer> buffers[max_frames_in_flight];
+	size_t used[max_frames_in_flight];
+};
+
+// NOTE: Indexed by jobs::threadIndex()
+std::vector<ThreadPools> thread_pools;
+
+VkCommandBuffer acquireBuffer() {
+	ThreadPools& pools = thread_pools[jobs::threadIndex()];
+	const uint32_t slot = veekay::app.frame_index;
+
+	if (pools.used[slot] == pools.buffers[slot].size()) {
+		VkCommandBufferAllocateInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = pools.pools[slot],
+			.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+			.commandBufferCount = 1,
+		};
+
+		VkCommandBuffer cmd;
+		if (vkAllocateCommandBuffers(veekay::app.vk_device, &info, &cmd) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate secondary command buffer");
+		}
+
+		pools.buffers[slot].push_back(cmd);
+	}
+
+	return pools.buffers[slot][pools.used[slot]++];
+}
+
+VkCommandBuffer recordBatch(const VkCommandBufferInheritanceInfo& inheritance,
+                            size_t begin, size_t end, const RecordFunc& record) {
+	trace::Scope scope("Record batch");
+
+	VkCommandBuffer cmd = acquireBuffer();
+
+	VkCommandBufferBeginInfo info{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+		         VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+		.pInheritanceInfo = &inheritance,
+	};
+
+	vkBeginCommandBuffer(cmd, &info);
+	record(cmd, begin, end);
+	vkEndCommandBuffer(cmd);
+
+	return cmd;
+}
+
+void recordBatches(VkCommandBuffer cmd, const VkCommandBufferInheritanceInfo& inheritance,
+                   size_t count, const RecordFunc& record, size_t min_batch) {
+	if (count == 0) {
+		return;
+	}
+
+	min_batch = std::max<size_t>(min_batch, 1);
+
+	const size_t batch_count = std::min({size_t(jobs::threadCount()), max_batches,
+	                                     (count + min_batch - 1) / min_batch});
+
+	// NOTE: Batches are as even as possible, first ones get one item more
+	const size_t size = count / batch_count;
+	const size_t remainder = count % batch_count;
+
+	VkCommandBuffer results[max_batches];
+
+	auto batch = [&](size_t index) {
+		const size_t begin = index * size + std::min(index, remainder);
+		const size_t end = begin + size + (index < remainder ? 1 : 0);
+
+		results[index] = recordBatch(inheritance, begin, end, record);
+	};
+
+	jobs::Counter counter;
+
+	for (size_t i = 1; i < batch_count; ++i) {
+		jobs::run([&batch, i] { batch(i); }, &counter);
+	}
+
+	// NOTE: Calling thread takes the first batch instead of idling
+	batch(0);
+
+	{
+		trace::Scope scope("Wait for recording");
+		jobs::wait(counter);
+	}
+
+	vkCmdExecuteCommands(cmd, uint32_t(batch_count), results);
+}
+
+} // namespace
+
+void recordParallel(VkCommandBuffer cmd, VkFramebuffer framebuffer,
+                    size_t count, const RecordFunc& record,
+                    size_t min_batch) {
+	VkCommandBufferInheritanceInfo inheritance{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		.renderPass = veekay::app.vk_render_pass,
+		.subpass = 0,
+		.framebuffer = framebuffer,
+	};
+
+	recordBatches(cmd, inheritance, count, record, min_batch);
+}
+
+void recordParallel(VkCommandBuffer cmd, const VkCommandBufferInheritanceRenderingInfoKHR& rendering,
+                    size_t count, const RecordFunc& record,
+                    size_t min_batch) {
+	VkCommandBufferInheritanceInfo inheritance{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		.pNext = &rendering,
+	};
+
+	recordBatches(cmd, inheritance, count, record, min_batch);
+}
+
+uint32_t recordingThreads() {
+	return jobs::threadCount();
+}
+
+namespace recording {
+
+// NOTE: Job system must be running already
+void init(uint32_t queue_family) {
+	thread_pools.resize(jobs::threadSlots());
+
+	for (ThreadPools& pools : thread_pools) {
+		for (uint32_t slot = 0; slot < max_frames_in_flight; ++slot) {
+			VkCommandPoolCreateInfo info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+				.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+				.queueFamilyIndex = queue_family,
+			};
+
+			if (vkCreateCommandPool(veekay::app.vk_device, &info, nullptr, &pools.pools[slot]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create recording command pool");
+			}
+
+			pools.used[slot] = 0;
+		}
+	}
+}
+
+// NOTE: Called once GPU finishes previous frame of app.frame_index slot, before recording into it
+void newFrame() {
+	const uint32_t slot = veekay::app.frame_index;
+
+	for (ThreadPools& pools : thread_pools) {
+		if (pools.used[slot] > 0) {
+			vkResetCommandPool(veekay::app.vk_device, pools.pools[slot], 0);
+			pools.used[slot] = 0;
+		}
+	}
+}
+
+void shutdown() {
+	for (ThreadPools& pools : thread_pools) {
+		for (uint32_t slot = 0; slot < max_frames_in_flight; ++slot) {
+			vkDestroyCommandPool(veekay::app.vk_device, pools.pools[slot], nullptr);
+		}
+	}
+
+	thread_pools.clear();
+}
+
+} // namespace recording
+
+} // namespace veekay::graphics
@@ -0,0 +1,908 @@
+#include <veekay/render_graph.hpp>
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <veekay/application.hpp>
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::graphics {
+
+namespace {
+
+constexpr uint32_t no_pass = std::numeric_limits<uint32_t>::max();
+
+constexpr VkAccessFlags write_access_mask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                            VK_ACCESS_TRANSFER_WRITE_BIT |
+                                            VK_ACCESS_SHADER_WRITE_BIT;
+
+struct AccessInfo {
+	VkPipelineStageFlags stages;
+	VkAccessFlags access;
+	VkImageLayout layout;
+	VkImageUsageFlags usage;
+};
+
+AccessInfo accessInfo(GraphAccess access) {
+	switch (access) {
+		case GraphAccess::color_attachment:
+			return {
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+			};
+
+		case GraphAccess::depth_attachment:
+			return {
+				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+				VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+			};
+
+		case GraphAccess::depth_read:
+			return {
+				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+				VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+			};
+
+		case GraphAccess::sampled:
+			return {
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_IMAGE_USAGE_SAMPLED_BIT,
+			};
+
+		case GraphAccess::transfer_source:
+			return {
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_ACCESS_TRANSFER_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			};
+
+		case GraphAccess::transfer_destination:
+			return {
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+			};
+	}
+
+	throw std::runtime_error("Unknown render graph access");
+}
+
+bool isWriteAccess(GraphAccess access) {
+	return access == GraphAccess::color_attachment ||
+	       access == GraphAccess::depth_attachment ||
+	       access == GraphAccess::transfer_destination;
+}
+
+// NOTE: Imported image contents that outlive a frame
+bool isKept(const RenderGraph::Image& image) {
+	return image.imported && image.final_layout != VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+bool isAttachmentAccess(GraphAccess access) {
+	return access == GraphAccess::color_attachment ||
+	       access == GraphAccess::depth_attachment ||
+	       access == GraphAccess::depth_read;
+}
+
+VkImageAspectFlags aspectMask(VkFormat format) {
+	switch (format) {
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
+
+// NOTE: Bytes per texel of attachment formats, only used to estimate traffic
+VkDeviceSize texelSize(VkFormat format) {
+	switch (format) {
+		case VK_FORMAT_R8_UNORM:
+			return 1;
+
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_R8G8_UNORM:
+			return 2;
+
+		case VK_FORMAT_R16G16B16A16_UNORM:
+		case VK_FORMAT_R16G16B16A16_SFLOAT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return 8;
+
+		case VK_FORMAT_R32G32B32A32_SFLOAT:
+			return 16;
+
+		default:
+			return 4;
+	}
+}
+
+} // namespace
+
+RenderGraph::~RenderGraph() {
+	VkDevice& device = veekay::app.vk_device;
+
+	for (const Image& image : images) {
+		if (image.imported) {
+			continue;
+		}
+
+		if (image.view != VK_NULL_HANDLE) {
+			vkDestroyImageView(device, image.view, nullptr);
+		}
+
+		if (image.image != VK_NULL_HANDLE) {
+			vkDestroyImage(device, image.image, nullptr);
+		}
+	}
+
+	for (const MemorySlot& slot : memory_slots) {
+		memory::free(slot.allocation);
+	}
+}
+
+GraphImage RenderGraph::createImage(const char* name, const GraphImageInfo& info) {
+	if (compiled) {
+		throw std::runtime_error("Render graph is already compiled");
+	}
+
+	images.push_back(Image{
+		.name = name,
+		.info = info,
+		.imported = false,
+		.initial_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.final_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+	});
+
+	return GraphImage(images.size() - 1);
+}
+
+GraphImage RenderGraph::importImage(const char* name, VkFormat format,
+                                    VkImageLayout initial_layout, VkImageLayout final_layout) {
+	if (compiled) {
+		throw std::runtime_error("Render graph is already compiled");
+	}
+
+	images.push_back(Image{
+		.name = name,
+		.info = {.format = format},
+		.imported = true,
+		.initial_layout = initial_layout,
+		.final_layout = final_layout,
+	});
+
+	return GraphImage(images.size() - 1);
+}
+
+void RenderGraph::setImage(GraphImage image, VkImage handle, VkImageView view,
+                           uint32_t width, uint32_t height) {
+	Image& target = images[image];
+
+	if (!target.imported) {
+		throw std::runtime_error("Render graph image is not imported");
+	}
+
+	target.image = handle;
+	target.view = view;
+	target.info.width = width;
+	target.info.height = height;
+}
+
+GraphPass RenderGraph::addPass(const char* name, GraphPassFunc function,
+                               VkRenderingFlagsKHR rendering_flags) {
+	if (compiled) {
+		throw std::runtime_error("Render graph is already compiled");
+	}
+
+	passes.push_back(Pass{
+		.name = name,
+		.function = std::move(function),
+		.rendering_flags = rendering_flags,
+	});
+
+	return GraphPass(passes.size() - 1);
+}
+
+void RenderGraph::read(GraphPass pass, GraphImage image, GraphAccess access) {
+	if (access == GraphAccess::transfer_destination) {
+		throw std::runtime_error("Render graph read has write only access");
+	}
+
+	passes[pass].uses.push_back(Use{
+		.image = image,
+		.access = access,
+		.write = false,
+	});
+}
+
+void RenderGraph::write(GraphPass pass, GraphImage image, GraphAccess access,
+                        const VkClearValue* clear) {
+	if (!isWriteAccess(access)) {
+		throw std::runtime_error("Render graph write has read only access");
+	}
+
+	Use use{
+		.image = image,
+		.access = access,
+		.write = true,
+		.clear = clear != nullptr,
+	};
+
+	if (clear) {
+		use.clear_value = *clear;
+	}
+
+	passes[pass].uses.push_back(use);
+}
+
+void RenderGraph::compile() {
+	if (compiled) {
+		throw std::runtime_error("Render graph is already compiled");
+	}
+
+	VkDevice& device = veekay::app.vk_device;
+
+	begin_rendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(
+		vkGetDeviceProcAddr(device, "vkCmdBeginRenderingKHR"));
+	end_rendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(
+		vkGetDeviceProcAddr(device, "vkCmdEndRenderingKHR"));
+
+	if (!begin_rendering || !end_rendering) {
+		throw std::runtime_error("Failed to load VK_KHR_dynamic_rendering functions");
+	}
+
+	stats = {};
+
+	{ // NOTE: Order passes so that reads come after writes they read and writes after
+	  //       reads of previous contents, otherwise declaration order is kept. Read
+	  //       with no writer declared before it waits for the first one after it
+		const uint32_t pass_count = uint32_t(passes.size());
+
+		std::vector<std::vector<uint32_t>> successors(pass_count);
+		std::vector<uint32_t> dependencies(pass_count);
+
+		auto depend = [&](uint32_t before, uint32_t after) {
+			if (before != after) {
+				successors[before].push_back(after);
+				++dependencies[after];
+			}
+		};
+
+		for (uint32_t image = 0; image < images.size(); ++image) {
+			const bool loaded = images[image].imported &&
+			                    images[image].initial_layout != VK_IMAGE_LAYOUT_UNDEFINED;
+
+			uint32_t last_writer = no_pass;
+
+			// NOTE: Readers of current contents, next writer waits for them
+			std::vector<uint32_t> readers;
+
+			// NOTE: Readers declared before anything wrote the image
+			std::vector<uint32_t> waiting;
+
+			for (uint32_t i = 0; i < pass_count; ++i) {
+				bool reads = false;
+				bool writes = false;
+
+				for (const Use& use : passes[i].uses) {
+					if (use.image == image) {
+						reads = reads || !use.write;
+						writes = writes || use.write;
+					}
+				}
+
+				if (reads) {
+					if (last_writer != no_pass) {
+						depend(last_writer, i);
+						readers.push_back(i);
+					} else if (loaded) {
+						readers.push_back(i);
+					} else {
+						waiting.push_back(i);
+					}
+				}
+
+				if (writes) {
+					if (last_writer != no_pass) {
+						depend(last_writer, i);
+					}
+
+					for (uint32_t reader : readers) {
+						depend(reader, i);
+					}
+
+					readers.clear();
+
+					for (uint32_t reader : waiting) {
+						depend(i, reader);
+						readers.push_back(reader);
+					}
+
+					waiting.clear();
+					last_writer = i;
+				}
+			}
+
+			if (!waiting.empty()) {
+				throw std::runtime_error(std::string("Render graph pass \"") + passes[waiting[0]].name +
+				                         "\" reads image \"" + images[image].name + "\" nothing writes");
+			}
+		}
+
+		std::vector<Pass> sorted;
+		std::vector<bool> placed(pass_count);
+
+		sorted.reserve(pass_count);
+
+		// NOTE: Earliest declared pass whose dependencies are placed goes next
+		while (sorted.size() < pass_count) {
+			uint32_t next = 0;
+
+			while (next < pass_count && (placed[next] || dependencies[next] != 0)) {
+				++next;
+			}
+
+			if (next == pass_count) {
+				throw std::runtime_error("Render graph passes depend on each other in a cycle");
+			}
+
+			placed[next] = true;
+
+			for (uint32_t successor : successors[next]) {
+				--dependencies[successor];
+			}
+
+			sorted.push_back(std::move(passes[next]));
+		}
+
+		passes = std::move(sorted);
+	}
+
+	{ // NOTE: Walk passes backwards, keeping only those which produce something needed later
+		std::vector<bool> needed(images.size());
+
+		for (size_t i = 0; i < images.size(); ++i) {
+			needed[i] = isKept(images[i]);
+		}
+
+		for (size_t i = passes.size(); i-- > 0;) {
+			Pass& pass = passes[i];
+
+			bool writes = false;
+			bool alive = false;
+
+			for (const Use& use : pass.uses) {
+				if (use.write) {
+					writes = true;
+					alive = alive || needed[use.image];
+				}
+			}
+
+			pass.culled = writes && !alive;
+
+			if (pass.culled) {
+				++stats.culled_passes;
+				continue;
+			}
+
+			++stats.passes;
+
+			// NOTE: Cleared image doesn't depend on whatever was written before
+			for (const Use& use : pass.uses) {
+				if (use.write && use.clear) {
+					needed[use.image] = false;
+				}
+			}
+
+			for (const Use& use : pass.uses) {
+				if (!use.write || !use.clear) {
+					needed[use.image] = true;
+				}
+			}
+		}
+	}
+
+	for (Image& image : images) {
+		image.first_pass = no_pass;
+		image.last_pass = 0;
+		image.usage = 0;
+
+		if (!image.imported) {
+			if (image.info.width == 0) {
+				image.info.width = veekay::app.window_width;
+			}
+
+			if (image.info.height == 0) {
+				image.info.height = veekay::app.window_height;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < passes.size(); ++i) {
+		if (passes[i].culled) {
+			continue;
+		}
+
+		for (const Use& use : passes[i].uses) {
+			Image& image = images[use.image];
+
+			image.first_pass = std::min(image.first_pass, i);
+			image.last_pass = std::max(image.last_pass, i);
+			image.usage |= accessInfo(use.access).usage;
+		}
+	}
+
+	std::vector<VkMemoryRequirements> requirements(images.size());
+	std::vector<GraphImage> transients;
+
+	for (uint32_t i = 0; i < images.size(); ++i) {
+		Image& image = images[i];
+
+		if (image.imported || image.first_pass == no_pass) {
+			continue;
+		}
+
+		// NOTE: Contents of attachment-only images never leave tile memory on
+		//       tile-based GPUs, so they need no memory behind them
+		const VkImageUsageFlags attachment_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+		                                           VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+		if ((image.usage & ~attachment_usage) == 0) {
+			image.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+
+		VkImageCreateInfo info{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = image.info.format,
+			.extent = {
+				.width = image.info.width,
+				.height = image.info.height,
+				.depth = 1,
+			},
+			.mipLevels = 1,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = image.usage,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		};
+
+		if (vkCreateImage(device, &info, nullptr, &image.image) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Vulkan image");
+		}
+
+		vkGetImageMemoryRequirements(device, image.image, &requirements[i]);
+
+		stats.transient_size += requirements[i].size;
+		transients.push_back(i);
+	}
+
+	// NOTE: Largest images first, each goes to the first slot whose images
+	//       don't live at the same time and share a memory type with it
+	std::stable_sort(transients.begin(), transients.end(), [&](GraphImage a, GraphImage b) {
+		return requirements[a].size > requirements[b].size;
+	});
+
+	for (GraphImage index : transients) {
+		Image& image = images[index];
+		const VkMemoryRequirements& image_requirements = requirements[index];
+
+		uint32_t slot_index = uint32_t(memory_slots.size());
+
+		for (uint32_t i = 0; i < memory_slots.size(); ++i) {
+			const MemorySlot& slot = memory_slots[i];
+
+			if ((slot.requirements.memoryTypeBits & image_requirements.memoryTypeBits) == 0) {
+				continue;
+			}
+
+			const bool overlaps = std::any_of(slot.images.begin(), slot.images.end(), [&](GraphImage other) {
+				return images[other].first_pass <= image.last_pass &&
+				       image.first_pass <= images[other].last_pass;
+			});
+
+			if (!overlaps) {
+				slot_index = i;
+				break;
+			}
+		}
+
+		if (slot_index == memory_slots.size()) {
+			memory_slots.push_back(MemorySlot{
+				.requirements = image_requirements,
+			});
+		} else {
+			VkMemoryRequirements& slot_requirements = memory_slots[slot_index].requirements;
+
+			slot_requirements.size = std::max(slot_requirements.size, image_requirements.size);
+			slot_requirements.alignment = std::max(slot_requirements.alignment, image_requirements.alignment);
+			slot_requirements.memoryTypeBits &= image_requirements.memoryTypeBits;
+		}
+
+		memory_slots[slot_index].images.push_back(index);
+		image.slot = slot_index;
+	}
+
+	for (MemorySlot& slot : memory_slots) {
+		// NOTE: Lazily allocated types are in memoryTypeBits only if all images of a slot are transient
+		slot.allocation = memory::allocate(slot.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                                   VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+		                                   false, MemoryCategory::attachment);
+
+		stats.aliased_size += slot.requirements.size;
+
+		for (GraphImage index : slot.images) {
+			Image& image = images[index];
+
+			if (vkBindImageMemory(device, image.image, slot.allocation.memory,
+			                      slot.allocation.offset) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to bind Vulkan image memory");
+			}
+
+			// NOTE: Depth images are viewed without stencil, so they can be sampled
+			const VkImageAspectFlags aspect = aspectMask(image.info.format);
+
+			VkImageViewCreateInfo info{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+				.image = image.image,
+				.viewType = VK_IMAGE_VIEW_TYPE_2D,
+				.format = image.info.format,
+				.subresourceRange = {
+					.aspectMask = (aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? VkImageAspectFlags(VK_IMAGE_ASPECT_DEPTH_BIT) : aspect,
+					.baseMipLevel = 0,
+					.levelCount = 1,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+			};
+
+			if (vkCreateImageView(device, &info, nullptr, &image.view) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create Vulkan image view");
+			}
+		}
+	}
+
+	// NOTE: Transient images live in memory slots, so their state is tracked
+	//       per slot: first use of an image in a frame discards its contents and
+	//       waits for whatever the slot was used for before, be it another image
+	//       or the same image in the previous frame
+	std::vector<State> slot_states(memory_slots.size());
+	std::vector<State> image_states(images.size());
+
+	auto plan = [&](bool record) {
+		for (size_t i = 0; i < images.size(); ++i) {
+			const Image& image = images[i];
+
+			if (image.imported) {
+				image_states[i] = State{
+					.layout = image.initial_layout,
+					.write_stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+					.write_access = image.initial_layout == VK_IMAGE_LAYOUT_UNDEFINED
+					                ? VkAccessFlags(0) : VkAccessFlags(VK_ACCESS_MEMORY_WRITE_BIT),
+				};
+			}
+		}
+
+		for (uint32_t i = 0; i < passes.size(); ++i) {
+			Pass& pass = passes[i];
+
+			if (pass.culled) {
+				continue;
+			}
+
+			Batch batch{};
+
+			for (const Use& use : pass.uses) {
+				const Image& image = images[use.image];
+				const AccessInfo info = accessInfo(use.access);
+
+				State& state = image.imported ? image_states[use.image] : slot_states[image.slot];
+
+				if (!image.imported && image.first_pass == i) {
+					state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+				}
+
+				const bool layout_change = state.layout != info.layout;
+				const VkPipelineStageFlags previous_stages = state.write_stages | state.read_stages;
+
+				Barrier barrier{
+					.image = use.image,
+					.old_layout = state.layout,
+					.new_layout = info.layout,
+					.dst_access = info.access,
+				};
+
+				bool needs_barrier = false;
+
+				if (layout_change || use.write) {
+					// NOTE: Waits for the last write and all reads after it
+					needs_barrier = layout_change || previous_stages != 0;
+					barrier.src_access = state.write_access;
+					batch.src_stages |= previous_stages;
+
+					// NOTE: Layout transition counts as a write, later reads wait for it
+					state = State{
+						.layout = info.layout,
+						.write_stages = info.stages,
+						.write_access = use.write ? (info.access & write_access_mask) : 0,
+						.read_stages = use.write ? 0 : info.stages,
+						.read_access = use.write ? 0 : info.access,
+					};
+				} else {
+					const bool covered = (state.read_stages & info.stages) == info.stages &&
+					                     (state.read_access & info.access) == info.access;
+
+					if (!covered && state.write_stages != 0) {
+						needs_barrier = true;
+						barrier.src_access = state.write_access;
+						batch.src_stages |= state.write_stages;
+					}
+
+					state.read_stages |= info.stages;
+					state.read_access |= info.access;
+				}
+
+				if (needs_barrier) {
+					batch.dst_stages |= info.stages;
+					batch.barriers.push_back(barrier);
+				}
+			}
+
+			if (record) {
+				pass.batch = std::move(batch);
+			}
+		}
+
+		if (!record) {
+			return;
+		}
+
+		final_batch = Batch{};
+
+		for (size_t i = 0; i < images.size(); ++i) {
+			const Image& image = images[i];
+			const State& state = image_states[i];
+
+			if (!isKept(image) || image.first_pass == no_pass) {
+				continue;
+			}
+
+			if (state.layout == image.final_layout && state.write_access == 0) {
+				continue;
+			}
+
+			const bool present = image.final_layout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+			final_batch.src_stages |= state.write_stages | state.read_stages;
+			final_batch.dst_stages |= present ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT
+			                                  : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+			final_batch.barriers.push_back(Barrier{
+				.image = GraphImage(i),
+				.old_layout = state.layout,
+				.new_layout = image.final_layout,
+				.src_access = state.write_access,
+				.dst_access = present ? VkAccessFlags(0)
+				                      : VkAccessFlags(VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT),
+			});
+		}
+	};
+
+	// NOTE: First run leaves memory slots in the state previous frame ends with
+	plan(false);
+	plan(true);
+
+	{ // NOTE: Load and store ops, contents are kept only if somebody reads them later
+		std::vector<bool> valid(images.size());
+
+		for (size_t i = 0; i < images.size(); ++i) {
+			valid[i] = images[i].imported && images[i].initial_layout != VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+
+		for (uint32_t i = 0; i < passes.size(); ++i) {
+			Pass& pass = passes[i];
+
+			pass.color_attachments.clear();
+			pass.has_depth = false;
+
+			if (pass.culled) {
+				continue;
+			}
+
+			for (const Use& use : pass.uses) {
+				const Image& image = images[use.image];
+
+				if (isAttachmentAccess(use.access)) {
+					Attachment attachment{
+						.image = use.image,
+						.layout = accessInfo(use.access).layout,
+						.load_op = use.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR :
+						           valid[use.image] ? VK_ATTACHMENT_LOAD_OP_LOAD :
+						           VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+						.store_op = (isKept(image) || image.last_pass > i) ? VK_ATTACHMENT_STORE_OP_STORE
+						                                                   : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+						.clear_value = use.clear_value,
+					};
+
+					if (use.access == GraphAccess::color_attachment) {
+						pass.color_attachments.push_back(attachment);
+					} else {
+						pass.has_depth = true;
+						pass.depth_attachment = attachment;
+					}
+				}
+
+				if (use.write) {
+					valid[use.image] = true;
+				}
+			}
+		}
+	}
+
+	for (const Pass& pass : passes) {
+		if (!pass.culled && !pass.batch.barriers.empty()) {
+			++stats.barrier_batches;
+			stats.image_barriers += uint32_t(pass.batch.barriers.size());
+		}
+	}
+
+	if (!final_batch.barriers.empty()) {
+		++stats.barrier_batches;
+		stats.image_barriers += uint32_t(final_batch.barriers.size());
+	}
+
+	compiled = true;
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd) {
+	if (!compiled) {
+		throw std::runtime_error("Render graph is not compiled");
+	}
+
+	std::vector<VkImageMemoryBarrier> barriers;
+
+	auto emit = [&](const Batch& batch) {
+		if (batch.barriers.empty()) {
+			return;
+		}
+
+		barriers.clear();
+
+		for (const Barrier& barrier : batch.barriers) {
+			const Image& image = images[barrier.image];
+
+			barriers.push_back(VkImageMemoryBarrier{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.srcAccessMask = barrier.src_access,
+				.dstAccessMask = barrier.dst_access,
+				.oldLayout = barrier.old_layout,
+				.newLayout = barrier.new_layout,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = image.image,
+				.subresourceRange = {
+					.aspectMask = aspectMask(image.info.format),
+					.baseMipLevel = 0,
+					.levelCount = 1,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+			});
+		}
+
+		vkCmdPipelineBarrier(cmd,
+		                     batch.src_stages ? batch.src_stages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		                     batch.dst_stages ? batch.dst_stages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		                     0, 0, nullptr, 0, nullptr,
+		                     uint32_t(barriers.size()), barriers.data());
+	};
+
+	std::vector<VkRenderingAttachmentInfoKHR> color_attachments;
+
+	for (const Pass& pass : passes) {
+		if (pass.culled) {
+			continue;
+		}
+
+		emit(pass.batch);
+
+		if (pass.color_attachments.empty() && !pass.has_depth) {
+			pass.function(cmd);
+			continue;
+		}
+
+		auto attachmentInfo = [&](const Attachment& attachment) {
+			return VkRenderingAttachmentInfoKHR{
+				.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+				.imageView = images[attachment.image].view,
+				.imageLayout = attachment.layout,
+				.resolveMode = VK_RESOLVE_MODE_NONE,
+				.loadOp = attachment.load_op,
+				.storeOp = attachment.store_op,
+				.clearValue = attachment.clear_value,
+			};
+		};
+
+		color_attachments.clear();
+
+		for (const Attachment& attachment : pass.color_attachments) {
+			color_attachments.push_back(attachmentInfo(attachment));
+		}
+
+		VkRenderingAttachmentInfoKHR depth_attachment{};
+
+		if (pass.has_depth) {
+			depth_attachment = attachmentInfo(pass.depth_attachment);
+		}
+
+		const Image& first = images[pass.color_attachments.empty() ? pass.depth_attachment.image
+		                                                            : pass.color_attachments[0].image];
+
+		VkRenderingInfoKHR info{
+			.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
+			.flags = pass.rendering_flags,
+			.renderArea = {
+				.extent = {first.info.width, first.info.height},
+			},
+			.layerCount = 1,
+			.colorAttachmentCount = uint32_t(color_attachments.size()),
+			.pColorAttachments = color_attachments.data(),
+			.pDepthAttachment = pass.has_depth ? &depth_attachment : nullptr,
+		};
+
+		++veekay::app.attachment_passes;
+
+		auto countTraffic = [&](const Attachment& attachment) {
+			const Image& image = images[attachment.image];
+			const VkDeviceSize size = VkDeviceSize(image.info.width) * image.info.height *
+			                          texelSize(image.info.format);
+
+			veekay::app.attachment_traffic += (attachment.load_op == VK_ATTACHMENT_LOAD_OP_LOAD ? size : 0) +
+			                                  (attachment.store_op == VK_ATTACHMENT_STORE_OP_STORE ? size : 0);
+		};
+
+		for (const Attachment& attachment : pass.color_attachments) {
+			countTraffic(attachment);
+		}
+
+		if (pass.has_depth) {
+			countTraffic(pass.depth_attachment);
+		}
+
+		begin_rendering(cmd, &info);
+		pass.function(cmd);
+		end_rendering(cmd);
+	}
+
+	emit(final_batch);
+}
+
+VkImageView RenderGraph::imageView(GraphImage image) const {
+	return images[image].view;
+}
+
+} // namespace veekay::graphics
@@ -0,0 +1,210 @@
+#include <veekay/simulation.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <veekay/application.hpp>
+#include <veekay/jobs.hpp>
+#include <veekay/trace.hpp>
+
+namespace veekay::simulation {
+
+namespace {
+
+// NOTE: Simulation further behind real time than this drops
+//       the rest instead of trying to catch up and falling behind more
+constexpr uint32_t max_catch_up_ticks = 5;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Snapshot {
+	std::vector<char> data;
+
+	// NOTE: Seconds since start when tick was due, render time is compared to it
+	double due_time;
+};
+
+TickFunc tick_function;
+double tick_duration;
+Clock::time_point start_time;
+
+std::thread thread;
+
+// NOTE: Guards everything shared between simulation and render threads
+std::mutex mutex;
+std::condition_variable stop_condition;
+bool stopping;
+
+Snapshot published_previous;
+Snapshot published_current;
+uint64_t published_ticks;
+uint64_t skipped_ticks;
+
+// NOTE: Simulation thread only, "working" stays between ticks
+//       and "spare" is swapped in when a tick is published
+std::vector<char> working;
+Snapshot spare;
+
+// NOTE: Render thread only, copied at the start of a frame
+Snapshot render_previous;
+Snapshot render_current;
+float render_alpha;
+uint64_t render_ticks;
+uint64_t render_skipped_ticks;
+
+double secondsSinceStart() {
+	return std::chrono::duration<double>(Clock::now() - start_time).count();
+}
+
+// NOTE: Copy is made outside of the lock, publishing only swaps buffers
+void publish(double due_time) {
+	std::copy(working.begin(), working.end(), spare.data.begin());
+	spare.due_time = due_time;
+
+	std::lock_guard lock(mutex);
+
+	std::swap(published_previous, published_current);
+	std::swap(published_current, spare);
+	++published_ticks;
+}
+
+void simulationLoop() {
+	trace::setThreadName("Simulation");
+
+	// NOTE: Ticks may use jobs, so thread needs its own slot instead of main thread's
+	jobs::registerThread();
+
+	uint64_t tick = 1;
+	double due_time = tick_duration;
+
+	std::unique_lock lock(mutex);
+
+	for (;;) {
+		const auto due = start_time + std::chrono::duration_cast<Clock::duration>(
+			std::chrono::duration<double>(due_time));
+
+		if (stop_condition.wait_until(lock, due, [] { return stopping; })) {
+			return;
+		}
+
+		lock.unlock();
+
+		trace::begin("Simulation tick");
+		tick_function(double(tick) * tick_duration, tick_duration, working.data());
+		trace::end();
+
+		publish(due_time);
+
+		++tick;
+		due_time += tick_duration;
+
+		const double now = secondsSinceStart();
+		uint64_t skipped = 0;
+
+		if (now - due_time > max_catch_up_ticks * tick_duration) {
+			skipped = uint64_t((now - due_time) / tick_duration);
+			due_time += double(skipped) * tick_duration;
+		}
+
+		lock.lock();
+		skipped_ticks += skipped;
+	}
+}
+
+} // namespace
+
+// NOTE: First tick runs on calling thread, so snapshots
+//       are valid from the very first frame
+void init(const SimulationInfo& info) {
+	tick_function = info.tick;
+
+	if (!tick_function) {
+		return;
+	}
+
+	tick_duration = 1.0 / double(info.tick_rate == 0 ? 60 : info.tick_rate);
+
+	working.assign(info.snapshot_size, 0);
+	tick_function(0.0, tick_duration, working.data());
+
+	published_previous.data = working;
+	published_current.data = working;
+	spare.data = working;
+	render_previous.data = working;
+	render_current.data = working;
+
+	published_ticks = 1;
+	skipped_ticks = 0;
+	stopping = false;
+
+	start_time = Clock::now();
+	thread = std::thread(simulationLoop);
+}
+
+void shutdown() {
+	if (!tick_function) {
+		return;
+	}
+
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+	}
+
+	stop_condition.notify_one();
+	thread.join();
+
+	tick_function = nullptr;
+}
+
+// NOTE: Latches two latest snapshots, rendered state is one tick behind
+//       real time, so that both ticks around it are already done
+void newFrame() {
+	if (!tick_function) {
+		return;
+	}
+
+	{
+		std::lock_guard lock(mutex);
+
+		std::copy(published_previous.data.begin(), published_previous.data.end(),
+		          render_previous.data.begin());
+		std::copy(published_current.data.begin(), published_current.data.end(),
+		          render_current.data.begin());
+
+		render_previous.due_time = published_previous.due_time;
+		render_current.due_time = published_current.due_time;
+
+		render_ticks = published_ticks;
+		render_skipped_ticks = skipped_ticks;
+	}
+
+	const double blend = (secondsSinceStart() - render_current.due_time) / tick_duration;
+	render_alpha = float(std::clamp(blend, 0.0, 1.0));
+}
+
+const void* previous() {
+	return tick_function ? render_previous.data.data() : nullptr;
+}
+
+const void* current() {
+	return tick_function ? render_current.data.data() : nullptr;
+}
+
+float alpha() {
+	return tick_function ? render_alpha : 1.0f;
+}
+
+uint64_t tickCount() {
+	return render_ticks;
+}
+
+uint64_t skippedTicks() {
+	return render_skipped_ticks;
+}
+
+} // namespace veekay::simulation
@@ -0,0 +1,182 @@
+#include <veekay/staging.hpp>
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include <veekay/application.hpp>
+#include <veekay/graphics.hpp>
+#include <vulkan/vulkan_core.h>
+
+namespace veekay::graphics::staging {
+
+namespace {
+
+constexpr VkDeviceSize ring_size = VkDeviceSize(32) << 20;
+
+// NOTE: Ring positions grow monotonically, actual offset is position % ring_size
+struct Frame {
+	uint64_t frame_number;
+	uint64_t end;
+};
+
+std::mutex mutex;
+
+Buffer* ring;
+
+uint64_t head;
+uint64_t tail;
+
+// NOTE: Start of allocations not yet submitted to GPU
+uint64_t open_begin;
+
+std::deque<Frame> frames;
+
+void retireOldest() {
+	const Frame& frame = frames.front();
+
+	waitForFrame(frame.frame_number);
+
+	tail = frame.end;
+	frames.pop_front();
+}
+
+} // namespace
+
+void init() {
+	ring = new Buffer(ring_size, nullptr,
+	                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+	                  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+	                  VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+	                  VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+	                  MemoryUsage::upload);
+
+	head = tail = open_begin = 0;
+}
+
+void shutdown() {
+	frames.clear();
+
+	delete ring;
+	ring = nullptr;
+}
+
+// NOTE: Allocations made since previous submission belong to "frame_number"
+void submitFrame(uint64_t frame_number) {
+	std::lock_guard lock(mutex);
+
+	if (head != open_begin) {
+		frames.push_back(Frame{frame_number, head});
+		open_begin = head;
+	}
+}
+
+// NOTE: GPU has finished every frame up to "completed_frame"
+void retireFrame(uint64_t completed_frame) {
+	std::lock_guard lock(mutex);
+
+	while (!frames.empty() && frames.front().frame_number <= completed_frame) {
+		tail = frames.front().end;
+		frames.pop_front();
+	}
+}
+
+// NOTE: Whole device is idle, everything is released
+void reset() {
+	std::lock_guard lock(mutex);
+
+	frames.clear();
+	tail = open_begin = head;
+}
+
+VkDeviceSize capacity() {
+	return ring_size;
+}
+
+bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment, StagingRange& result) {
+	if (size > ring_size) {
+		return false;
+	}
+
+	alignment = std::max<VkDeviceSize>(alignment, 1);
+
+	std::lock_guard lock(mutex);
+
+	// NOTE: Alignment may be any value, e.g. 12 byte texels, so offset in
+	//       the ring is rounded up with modulo instead of a mask. Ring start
+	//       is aligned to anything, allocations never wrap around ring end
+	const uint64_t head_offset = head % ring_size;
+	const uint64_t aligned_offset = (head_offset + alignment - 1) / alignment * alignment;
+
+	uint64_t begin = head - head_offset + aligned_offset;
+
+	if (aligned_offset + size > ring_size) {
+		begin = head - head_offset + ring_size;
+	}
+
+	const uint64_t end = begin + size;
+
+	while (end - tail > ring_size) {
+		if (frames.empty()) {
+			return false;
+		}
+
+		retireOldest();
+	}
+
+	head = end;
+
+	result = StagingRange{
+		.buffer = ring->buffer,
+		.offset = begin % ring_size,
+		.size = size,
+		.mapped = static_cast<char*>(ring->mapped_region) + begin % ring_size,
+	};
+
+	return true;
+}
+
+StagingRange allocate(VkDeviceSize size, VkDeviceSize alignment) {
+	StagingRange result;
+
+	if (!tryAllocate(size, alignment, result)) {
+		throw std::runtime_error("Staging ring buffer is too small for this frame uploads");
+	}
+
+	return result;
+}
+
+void copyToBuffer(VkCommandBuffer cmd, VkBuffer destination, VkDeviceSize offset,
+                  const void* data, VkDeviceSize size) {
+	const StagingRange range = allocate(size);
+
+	std::copy(static_cast<const char*>(data),
+	          static_cast<const char*>(data) + size,
+	          static_cast<char*>(range.mapped));
+
+	VkBufferCopy region{
+		.srcOffset = range.offset,
+		.dstOffset = offset,
+		.size = size,
+	};
+
+	vkCmdCopyBuffer(cmd, range.buffer, destination, 1, &region);
+}
+
+void copyToImage(VkCommandBuffer cmd, VkImage destination, VkBufferImageCopy region,
+                 VkDeviceSize texel_size, const void* data, VkDeviceSize size) {
+	const StagingRange range = allocate(size, Texture::copyAlignment(texel_size));
+
+	std::copy(static_cast<const char*>(data),
+	          static_cast<const char*>(data) + size,
+	          static_cast<char*>(range.mapped));
+
+	region.bufferOffset = range.offset;
+
+	vkCmdCopyBufferToImage(cmd, range.buffer, destination,
+	                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+} // namespace veekay::graphics::staging
@@ -0,0 +1,274 @@
+#include <veekay/trace.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <imgui.h>
+
+namespace veekay::trace {
+
+namespace {
+
+constexpr uint32_t ring_size = 1 << 14;
+constexpr uint32_t max_depth = 64;
+constexpr uint32_t frame_history = 512;
+constexpr uint32_t histogram_buckets = 32;
+
+// NOTE: Nanoseconds since program start
+struct Event {
+	const char* name;
+	uint64_t begin;
+	uint64_t end;
+};
+
+// NOTE: Fields are relaxed atomics, so that reading a slot being
+//       overwritten is not a data race, just an event to throw away
+struct Slot {
+	std::atomic<const char*> name;
+	std::atomic<uint64_t> begin;
+	std::atomic<uint64_t> end;
+};
+
+// NOTE: Written only by its thread, head is published with release
+//       so that exporting thread sees complete events
+struct Ring {
+	Slot slots[ring_size];
+	std::atomic<uint64_t> head;
+
+	uint32_t thread_id;
+	std::atomic<const char*> thread_name;
+};
+
+struct OpenScope {
+	const char* name;
+	uint64_t begin;
+};
+
+struct ThreadState {
+	Ring* ring;
+
+	OpenScope stack[max_depth];
+	uint32_t depth;
+};
+
+const auto start_time = std::chrono::steady_clock::now();
+
+// NOTE: Rings are never freed, so they outlive their threads
+//       and stay available for export
+std::mutex rings_mutex;
+std::vector<std::unique_ptr<Ring>> rings;
+
+thread_local ThreadState thread_state;
+
+// NOTE: Frame marks come from the main loop thread only
+float frame_times[frame_history];
+uint32_t frame_count;
+uint64_t last_frame_mark;
+
+uint64_t now() {
+	const auto elapsed = std::chrono::steady_clock::now() - start_time;
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+Ring* threadRing() {
+	if (thread_state.ring == nullptr) {
+		std::lock_guard lock(rings_mutex);
+
+		rings.push_back(std::make_unique<Ring>());
+
+		thread_state.ring = rings.back().get();
+		thread_state.ring->thread_id = uint32_t(rings.size());
+	}
+
+	return thread_state.ring;
+}
+
+void push(const char* name, uint64_t begin, uint64_t end) {
+	Ring* ring = threadRing();
+
+	const uint64_t head = ring->head.load(std::memory_order_relaxed);
+
+	Slot& slot = ring->slots[head % ring_size];
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.begin.store(begin, std::memory_order_relaxed);
+	slot.end.store(end, std::memory_order_relaxed);
+
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+void writeString(std::ostream& stream, const char* string) {
+	stream << '"';
+
+	for (const char* c = string; *c; ++c) {
+		if (*c == '"' || *c == '\\') {
+			stream << '\\';
+		}
+
+		stream << *c;
+	}
+
+	stream << '"';
+}
+
+} // namespace
+
+void begin(const char* name) {
+	ThreadState& state = thread_state;
+
+	// NOTE: Scopes nested deeper than max_depth are not recorded
+	if (state.depth < max_depth) {
+		state.stack[state.depth] = OpenScope{name, now()};
+	}
+
+	++state.depth;
+}
+
+void end() {
+	ThreadState& state = thread_state;
+
+	if (state.depth == 0) {
+		return;
+	}
+
+	--state.depth;
+
+	if (state.depth < max_depth) {
+		const OpenScope& scope = state.stack[state.depth];
+		push(scope.name, scope.begin, now());
+	}
+}
+
+void setThreadName(const char* name) {
+	threadRing()->thread_name.store(name, std::memory_order_release);
+}
+
+void frameMark() {
+	const uint64_t time = now();
+
+	if (last_frame_mark != 0) {
+		frame_times[frame_count % frame_history] = float(time - last_frame_mark) * 1e-6f;
+		++frame_count;
+
+		push("Frame", last_frame_mark, time);
+	}
+
+	last_frame_mark = time;
+}
+
+uint32_t frameTimes(float* result, uint32_t capacity) {
+	const uint32_t count = std::min({frame_count, frame_history, capacity});
+
+	for (uint32_t i = 0; i < count; ++i) {
+		result[i] = frame_times[(frame_count - count + i) % frame_history];
+	}
+
+	return count;
+}
+
+void writeChromeJson(std::ostream& stream) {
+	std::lock_guard lock(rings_mutex);
+
+	stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+
+	bool first = true;
+
+	for (const auto& ring : rings) {
+		if (const char* name = ring->thread_name.load(std::memory_order_acquire)) {
+			stream << (first ? "" : ",\n")
+			       << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+			       << ring->thread_id << ", \"args\": {\"name\": ";
+			writeString(stream, name);
+			stream << "}}";
+
+			first = false;
+		}
+
+		const uint64_t head = ring->head.load(std::memory_order_acquire);
+		const uint64_t tail = head > ring_size ? head - ring_size : 0;
+
+		for (uint64_t i = tail; i < head; ++i) {
+			const Slot& slot = ring->slots[i % ring_size];
+
+			const Event event{
+				slot.name.load(std::memory_order_relaxed),
+				slot.begin.load(std::memory_order_relaxed),
+				slot.end.load(std::memory_order_relaxed),
+			};
+
+			// NOTE: Owning thread keeps writing while we export,
+			//       events it has lapped since are skipped
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (ring->head.load(std::memory_order_relaxed) - i >= ring_size) {
+				continue;
+			}
+
+			stream << (first ? "" : ",\n") << "{\"name\": ";
+			writeString(stream, event.name);
+			stream << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << ring->thread_id
+			       << ", \"ts\": " << double(event.begin) * 1e-3
+			       << ", \"dur\": " << double(event.end - event.begin) * 1e-3 << '}';
+
+			first = false;
+		}
+	}
+
+	stream << "\n]}\n";
+}
+
+void drawImGui(bool* open) {
+	if (!ImGui::Begin("Frame times", open)) {
+		ImGui::End();
+		return;
+	}
+
+	float times[frame_history];
+	const uint32_t count = frameTimes(times, frame_history);
+
+	if (count == 0) {
+		ImGui::End();
+		return;
+	}
+
+	float sorted[frame_history];
+	std::copy(times, times + count, sorted);
+	std::sort(sorted, sorted + count);
+
+	float average = 0.0f;
+	for (uint32_t i = 0; i < count; ++i) {
+		average += times[i];
+	}
+	average /= count;
+
+	const float max = sorted[count - 1];
+	const float p99 = sorted[std::min(count - 1, count * 99 / 100)];
+
+	ImGui::Text("average %.2f ms (%.0f FPS), p99 %.2f ms, max %.2f ms",
+	            average, 1000.0f / average, p99, max);
+
+	const float scale = std::max(max, 1000.0f / 30.0f);
+
+	ImGui::PlotLines("##frame_times", times, int(count), 0, nullptr,
+	                 0.0f, scale, ImVec2(-1.0f, 80.0f));
+
+	float buckets[histogram_buckets] = {};
+	for (uint32_t i = 0; i < count; ++i) {
+		const uint32_t bucket = std::min(uint32_t(times[i] / scale * histogram_buckets),
+		                                 histogram_buckets - 1);
+		buckets[bucket] += 1.0f;
+	}
+
+	char label[64];
+	snprintf(label, sizeof(label), "0 - %.1f ms", scale);
+
+	ImGui::PlotHistogram("##frame_histogram", buckets, int(histogram_buckets), 0, label,
+	                     0.0f, float(count), ImVec2(-1.0f, 80.0f));
+
+	ImGui::End();
+}
+
+} // namespace veekay::trace
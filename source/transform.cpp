@@ -0,0 +1,210 @@
+#include <veekay/transform.hpp>
+
+#include <algorithm>
+
+#include <veekay/simd.hpp>
+
+namespace veekay {
+
+namespace {
+
+using simd::f32x4;
+
+// NOTE: Adding and subtracting 1.5 * 2^23 rounds to nearest integer
+//       without leaving float registers, valid for |value| < 2^22
+f32x4 roundNearest(f32x4 value) {
+	const f32x4 magic = simd::splat(12582912.0f);
+	return simd::sub(simd::add(value, magic), magic);
+}
+
+// NOTE: Branchless sine and cosine of 4 angles at once,
+//       Cody-Waite reduction to [-pi/4, pi/4] and minimax polynomials
+void sincos(f32x4 angle, f32x4& sine, f32x4& cosine) {
+	const f32x4 one = simd::splat(1.0f);
+	const f32x4 two = simd::splat(2.0f);
+
+	const f32x4 k = roundNearest(simd::mul(angle, simd::splat(0.636619772f)));
+
+	f32x4 x = simd::sub(angle, simd::mul(k, simd::splat(1.5703125f)));
+	x = simd::sub(x, simd::mul(k, simd::splat(4.837512969970703125e-4f)));
+	x = simd::sub(x, simd::mul(k, simd::splat(7.549789954891882e-8f)));
+
+	const f32x4 x2 = simd::mul(x, x);
+
+	f32x4 s = simd::splat(-1.9515295891e-4f);
+	s = simd::add(simd::mul(s, x2), simd::splat(8.3321608736e-3f));
+	s = simd::add(simd::mul(s, x2), simd::splat(-1.6666654611e-1f));
+	s = simd::add(simd::mul(simd::mul(s, x2), x), x);
+
+	f32x4 c = simd::splat(2.443315711809948e-5f);
+	c = simd::add(simd::mul(c, x2), simd::splat(-1.388731625493765e-3f));
+	c = simd::add(simd::mul(c, x2), simd::splat(4.166664568298827e-2f));
+	c = simd::add(simd::mul(c, x2), simd::splat(-0.5f));
+	c = simd::add(simd::mul(c, x2), one);
+
+	// NOTE: Quadrant q = k mod 4 decides swapping and signs:
+	//       q = 0: ( s,  c), q = 1: ( c, -s), q = 2: (-s, -c), q = 3: (-c,  s)
+	const f32x4 k_floor4 = roundNearest(simd::sub(simd::mul(k, simd::splat(0.25f)),
+	                                              simd::splat(0.375f)));
+	const f32x4 q = simd::sub(k, simd::mul(k_floor4, simd::splat(4.0f)));
+	const f32x4 high = roundNearest(simd::sub(simd::mul(q, simd::splat(0.5f)),
+	                                          simd::splat(0.25f)));
+	const f32x4 swap = simd::sub(q, simd::mul(high, two));
+
+	// NOTE: high xor swap, both are either 0 or 1
+	const f32x4 flip = simd::sub(simd::add(high, swap), simd::mul(two, simd::mul(high, swap)));
+
+	const f32x4 sine_sign = simd::sub(one, simd::mul(two, high));
+	const f32x4 cosine_sign = simd::sub(one, simd::mul(two, flip));
+
+	sine = simd::mul(sine_sign, simd::add(s, simd::mul(swap, simd::sub(c, s))));
+	cosine = simd::mul(cosine_sign, simd::add(c, simd::mul(swap, simd::sub(s, c))));
+}
+
+// NOTE: Loads up to 4 values, missing lanes are filled with "fill"
+f32x4 loadPartial(const float* values, size_t count, float fill) {
+	if (count >= 4) {
+		return simd::load(values);
+	}
+
+	float lanes[4] = {fill, fill, fill, fill};
+	std::copy(values, values + count, lanes);
+	return simd::load(lanes);
+}
+
+} // namespace
+
+void TransformBatch::resize(size_t count) {
+	position_x.resize(count, 0.0f);
+	position_y.resize(count, 0.0f);
+	position_z.resize(count, 0.0f);
+
+	rotation_x.resize(count, 0.0f);
+	rotation_y.resize(count, 0.0f);
+	rotation_z.resize(count, 0.0f);
+
+	scale_x.resize(count, 1.0f);
+	scale_y.resize(count, 1.0f);
+	scale_z.resize(count, 1.0f);
+}
+
+void TransformBatch::set(size_t index, const vec3& position,
+                         const vec3& rotation, const vec3& scale) {
+	position_x[index] = position.x;
+	position_y[index] = position.y;
+	position_z[index] = position.z;
+
+	rotation_x[index] = rotation.x;
+	rotation_y[index] = rotation.y;
+	rotation_z[index] = rotation.z;
+
+	scale_x[index] = scale.x;
+	scale_y[index] = scale.y;
+	scale_z[index] = scale.z;
+}
+
+namespace {
+
+// NOTE: Computes registers holding element [column][row] of model matrices
+//       of 4 consecutive objects starting at "index"
+void computeElements(const TransformBatch& batch, size_t index, size_t lanes,
+                     f32x4 (&columns)[4][4]) {
+	const f32x4 zero = simd::splat(0.0f);
+	const f32x4 one = simd::splat(1.0f);
+
+	f32x4 sx, cx, sy, cy, sz, cz;
+	sincos(loadPartial(&batch.rotation_x[index], lanes, 0.0f), sx, cx);
+	sincos(loadPartial(&batch.rotation_y[index], lanes, 0.0f), sy, cy);
+	sincos(loadPartial(&batch.rotation_z[index], lanes, 0.0f), sz, cz);
+
+	const f32x4 scale_0 = loadPartial(&batch.scale_x[index], lanes, 1.0f);
+	const f32x4 scale_1 = loadPartial(&batch.scale_y[index], lanes, 1.0f);
+	const f32x4 scale_2 = loadPartial(&batch.scale_z[index], lanes, 1.0f);
+
+	// NOTE: Rotation is Rz * Ry * Rx in column-vector notation,
+	//       each column gets multiplied by its scale factor
+	const f32x4 sy_sx = simd::mul(sy, sx);
+	const f32x4 sy_cx = simd::mul(sy, cx);
+
+	columns[0][0] = simd::mul(simd::mul(cz, cy), scale_0);
+	columns[0][1] = simd::mul(simd::mul(sz, cy), scale_0);
+	columns[0][2] = simd::mul(simd::sub(zero, sy), scale_0);
+	columns[0][3] = zero;
+
+	columns[1][0] = simd::mul(simd::sub(simd::mul(cz, sy_sx), simd::mul(sz, cx)), scale_1);
+	columns[1][1] = simd::mul(simd::add(simd::mul(sz, sy_sx), simd::mul(cz, cx)), scale_1);
+	columns[1][2] = simd::mul(simd::mul(cy, sx), scale_1);
+	columns[1][3] = zero;
+
+	columns[2][0] = simd::mul(simd::add(simd::mul(cz, sy_cx), simd::mul(sz, sx)), scale_2);
+	columns[2][1] = simd::mul(simd::sub(simd::mul(sz, sy_cx), simd::mul(cz, sx)), scale_2);
+	columns[2][2] = simd::mul(simd::mul(cy, cx), scale_2);
+	columns[2][3] = zero;
+
+	columns[3][0] = loadPartial(&batch.position_x[index], lanes, 0.0f);
+	columns[3][1] = loadPartial(&batch.position_y[index], lanes, 0.0f);
+	columns[3][2] = loadPartial(&batch.position_z[index], lanes, 0.0f);
+	columns[3][3] = one;
+}
+
+} // namespace
+
+void TransformBatch::computeMatrices(size_t first, size_t count,
+                                     void* result, size_t stride) const {
+	char* destination = static_cast<char*>(result);
+
+	for (size_t i = 0; i < count; i += 4) {
+		const size_t lanes = std::min<size_t>(count - i, 4);
+
+		f32x4 columns[4][4];
+		computeElements(*this, first + i, lanes, columns);
+
+		// NOTE: Registers hold one matrix element for 4 objects,
+		//       transposing turns them into one column of each object
+		for (auto& column : columns) {
+			simd::transpose(column[0], column[1], column[2], column[3]);
+		}
+
+		for (size_t lane = 0; lane < lanes; ++lane) {
+			float* matrix = reinterpret_cast<float*>(destination + (i + lane) * stride);
+
+			simd::store(matrix + 0, columns[0][lane]);
+			simd::store(matrix + 4, columns[1][lane]);
+			simd::store(matrix + 8, columns[2][lane]);
+			simd::store(matrix + 12, columns[3][lane]);
+		}
+	}
+}
+
+void TransformBatch::computeAffine(size_t first, size_t count,
+                                   void* result, size_t stride) const {
+	char* destination = static_cast<char*>(result);
+
+	for (size_t i = 0; i < count; i += 4) {
+		const size_t lanes = std::min<size_t>(count - i, 4);
+
+		f32x4 columns[4][4];
+		computeElements(*this, first + i, lanes, columns);
+
+		// NOTE: Row r of affine3x4 is element r of every column
+		f32x4 rows[3][4];
+		for (int r = 0; r < 3; ++r) {
+			rows[r][0] = columns[0][r];
+			rows[r][1] = columns[1][r];
+			rows[r][2] = columns[2][r];
+			rows[r][3] = columns[3][r];
+
+			simd::transpose(rows[r][0], rows[r][1], rows[r][2], rows[r][3]);
+		}
+
+		for (size_t lane = 0; lane < lanes; ++lane) {
+			float* affine = reinterpret_cast<float*>(destination + (i + lane) * stride);
+
+			simd::store(affine + 0, rows[0][lane]);
+			simd::store(affine + 4, rows[1][lane]);
+			simd::store(affine + 8, rows[2][lane]);
+		}
+	}
+}
+
+} // namespace veekay
@@ -1,8 +1,12 @@
 #include <cstdint>
 #include <climits>
+#include <cstdio>
 
 #include <iostream>
+#include <fstream>
+#include <exception>
 #include <vector>
+#include <algorithm>
 
 #include <vulkan/vulkan_core.h>
 
@@ -23,7 +27,7 @@ constexpr uint32_t window_default_width = 1280;
 constexpr uint32_t window_default_height = 720;
 constexpr char window_title[] = "Veekay";
 
-constexpr uint32_t max_frames_in_flight = 2;
+constexpr char pipeline_cache_path[] = "pipeline_cache.bin";
 
 GLFWwindow* window;
 
@@ -38,32 +42,85 @@ VkFormat vk_swapchain_format;
 std::vector<VkImage> vk_swapchain_images;
 std::vector<VkImageView> vk_swapchain_image_views;
 
+// NOTE: Layout color images are left in at the end of frame,
+//       headless mode keeps them ready for capture instead of presentation
+VkImageLayout vk_present_layout;
+
+// NOTE: Headless mode renders into offscreen images standing in for swapchain ones
+bool headless;
+std::vector<veekay::graphics::Allocation> offscreen_allocations;
+veekay::graphics::Buffer* capture_buffer;
+
 VkQueue vk_graphics_queue;
 uint32_t vk_graphics_queue_family;
 
-// NOTE: ImGui rendering objects
+// NOTE: VK_EXT_memory_budget is optional, used only for statistics
+bool vk_memory_budget;
+
+// NOTE: ImGui rendering objects, with integrated UI ImGui is drawn in the last
+//       subpass of vk_render_pass and has no render pass or framebuffers of its own
+bool integrated_ui;
 VkDescriptorPool imgui_descriptor_pool;
 VkRenderPass imgui_render_pass;
-VkCommandPool imgui_command_pool;
 std::vector<VkCommandBuffer> imgui_command_buffers;
 std::vector<VkFramebuffer> imgui_framebuffers;
 
+// NOTE: Transient depth is discarded after every frame
+bool vk_image_depth_transient;
 VkFormat vk_image_depth_format;
 VkImage vk_image_depth;
-VkDeviceMemory vk_image_depth_memory;
+veekay::graphics::Allocation vk_image_depth_allocation;
 VkImageView vk_image_depth_view;
 
 VkRenderPass vk_render_pass;
 std::vector<VkFramebuffer> vk_framebuffers;
 
+// NOTE: Dynamic rendering replaces vk_render_pass and framebuffers
+//       with vkCmdBeginRenderingKHR on swapchain image views
+bool dynamic_rendering;
+PFN_vkCmdBeginRenderingKHR vk_begin_rendering;
+PFN_vkCmdEndRenderingKHR vk_end_rendering;
+
+// NOTE: Binary semaphores order acquire and present, swapchain
+//       does not work with timeline ones
 std::vector<VkSemaphore> vk_render_semaphores;
 std::vector<VkSemaphore> vk_present_semaphores;
-std::vector<VkFence> vk_in_flight_fences;
+
+// NOTE: Reaches N once GPU finishes frame N
+VkSemaphore vk_frame_timeline;
 uint32_t vk_current_frame;
 
-VkCommandPool vk_command_pool;
+// NOTE: One pool per frame in flight, reset wholesale once GPU finishes its previous frame
+std::vector<VkCommandPool> vk_command_pools;
 std::vector<VkCommandBuffer> vk_command_buffers;
 
+// NOTE: Binary PPM, pixels are B8G8R8A8 as in swapchain format
+bool writeCapture(const char* path, const void* pixels, uint32_t width, uint32_t height) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	file << "P6\n" << width << ' ' << height << "\n255\n";
+
+	const uint8_t* source = static_cast<const uint8_t*>(pixels);
+	std::vector<uint8_t> row(width * 3);
+
+	for (uint32_t y = 0; y < height; ++y) {
+		for (uint32_t x = 0; x < width; ++x) {
+			const uint8_t* pixel = source + (size_t(y) * width + x) * 4;
+
+			row[x * 3 + 0] = pixel[2];
+			row[x * 3 + 1] = pixel[1];
+			row[x * 3 + 2] = pixel[0];
+		}
+
+		file.write(reinterpret_cast<const char*>(row.data()), row.size());
+	}
+
+	return bool(file);
+}
+
 } // namespace
 
 namespace veekay {
@@ -73,21 +130,93 @@ namespace veekay {
 	namespace input {
 
 		void setup(void* const window_ptr);
-		void cache();
+		void newFrame();
+		void latch();
 
 	} // namespace input
 
-	namespace graphics {
+	namespace jobs {
 
 		void init();
+		void shutdown();
+
+	} // namespace jobs
+
+	namespace simulation {
+
+		void init(const SimulationInfo& info);
+		void newFrame();
+		void shutdown();
+
+	} // namespace simulation
+
+	namespace graphics {
+
+		void init(bool memory_budget);
+		void finishUploads();
+		void submitFrame(uint64_t frame_number);
+		void retireFrame(uint64_t completed_frame);
+		void shutdown();
+
+		namespace pipeline_cache {
+
+			VkPipelineCache load(const char* path);
+			void save(VkPipelineCache cache, const char* path);
+
+		} // namespace pipeline_cache
+
+		namespace profiler {
+
+			void init(uint32_t queue_family);
+			void newFrame();
+			void shutdown();
+
+		} // namespace profiler
+
+		namespace recording {
+
+			void init(uint32_t queue_family);
+			void newFrame();
+			void shutdown();
+
+		} // namespace recording
 
 	} // namespace graphics
 
 } // namespace veekay
 
+void veekay::renderImGui(VkCommandBuffer cmd) {
+	graphics::profiler::begin(cmd, "ImGui");
+	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+	graphics::profiler::end(cmd);
+}
+
+void veekay::endRenderPass(VkCommandBuffer cmd) {
+	if (integrated_ui) {
+		vkCmdNextSubpass(cmd, VK_SUBPASS_CONTENTS_INLINE);
+		renderImGui(cmd);
+	}
+
+	vkCmdEndRenderPass(cmd);
+}
+
 int veekay::run(const veekay::ApplicationInfo& app_info) {
 	veekay::app.running = true;
-	
+
+	trace::setThreadName("Main");
+
+	headless = app_info.headless.enabled;
+	integrated_ui = app_info.integrated_ui;
+	dynamic_rendering = app_info.render_dynamic != nullptr;
+	vk_image_depth_transient = app_info.depth == DepthAttachment::transient;
+	vk_present_layout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	// NOTE: Null platform needs no display, GLFW still provides
+	//       timer, input state and a window object for ImGui
+	if (headless) {
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+	}
+
 	if (!glfwInit()) {
 		std::cerr << "Failed to initialize GLFW\n";
 		return 1;
@@ -96,17 +225,22 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
-	window = glfwCreateWindow(window_default_width, window_default_height,
+	const int window_width = (headless && app_info.headless.width) ?
+	                         int(app_info.headless.width) : int(window_default_width);
+	const int window_height = (headless && app_info.headless.height) ?
+	                          int(app_info.headless.height) : int(window_default_height);
+
+	window = glfwCreateWindow(window_width, window_height,
 	                          window_title, nullptr, nullptr);
 	if (!window) {
 		std::cerr << "Failed to create GLFW window\n";
 		return 1;
 	}
 
-	glfwSetWindowSize(window, window_default_width, window_default_height);
+	glfwSetWindowSize(window, window_width, window_height);
 
-	glfwSetWindowSizeLimits(window, window_default_width, window_default_height,
-	                        window_default_width, window_default_height);
+	glfwSetWindowSizeLimits(window, window_width, window_height,
+	                        window_width, window_height);
 
 	glfwPollEvents();
 
@@ -121,6 +255,9 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 	{ // NOTE: Initialize Vulkan: grab device and create swapchain
 		vkb::InstanceBuilder instance_builder;
 
+		// NOTE: Headless instance does not require surface extensions
+		instance_builder.set_headless(headless);
+
 		auto builder_result = instance_builder.require_api_version(1, 2, 0)
 		                                      .request_validation_layers()
 		                                      .use_default_debug_messenger()
@@ -135,26 +272,38 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		vk_instance = instance.instance;
 		vk_debug_messenger = instance.debug_messenger;
 
-		if (glfwCreateWindowSurface(vk_instance, window, nullptr, &vk_surface) != VK_SUCCESS) {
-			const char* message;
-			glfwGetError(&message);
-			std::cerr << message << '\n';
-			return 1;
-		}
-
 		vkb::PhysicalDeviceSelector physical_device_selector(instance);
 
+		if (!headless) {
+			if (glfwCreateWindowSurface(vk_instance, window, nullptr, &vk_surface) != VK_SUCCESS) {
+				const char* message;
+				glfwGetError(&message);
+				std::cerr << message << '\n';
+				return 1;
+			}
+
+			physical_device_selector.set_surface(vk_surface);
+		}
+
 		VkPhysicalDeviceFeatures device_features{
 			.samplerAnisotropy = true,
 		};
 
+		// NOTE: GPU profiler resets query pools from host,
+		//       frames are paced with a timeline semaphore
+		VkPhysicalDeviceVulkan12Features device_features_12{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+			.hostQueryReset = true,
+			.timelineSemaphore = true,
+		};
+
 		VkPhysicalDeviceDynamicRenderingFeaturesKHR dyn_rendering{
 			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR,
 			.dynamicRendering = true,
 		};
 
-		auto selector_result = physical_device_selector.set_surface(vk_surface)
-		                                               .set_required_features(device_features)
+		auto selector_result = physical_device_selector.set_required_features(device_features)
+		                                               .set_required_features_12(device_features_12)
 		                                               .add_required_extension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)
 		                                               .add_required_extension_features(dyn_rendering)
 		                                               .select();
@@ -165,6 +314,8 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 
 		auto physical_device = selector_result.value();
 
+		vk_memory_budget = physical_device.enable_extension_if_present(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
 		{
 			vkb::DeviceBuilder device_builder(physical_device);
 
@@ -186,184 +337,128 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			vk_graphics_queue_family = device.get_queue_index(queue_type).value();
 		}
 
-		vkb::SwapchainBuilder swapchain_builder(vk_physical_device, vk_device, vk_surface);
-
-		vk_swapchain_format = VK_FORMAT_B8G8R8A8_UNORM;
-
-		VkSurfaceFormatKHR surface_format{
-			.format = vk_swapchain_format,
-			.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
-		};
-
-		auto swapchain_result = swapchain_builder.set_desired_format(surface_format)
-		                                         .set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
-		                                         .set_desired_extent(app.window_width, app.window_height)
-		                                         .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
-		                                         .build();
-
-		if (!swapchain_result) {
-			std::cerr << swapchain_result.error().message() << '\n';
-			return 1;
-		}
-
-		auto swapchain = swapchain_result.value();
-
-		vk_swapchain = swapchain.swapchain;
-		vk_swapchain_images = swapchain.get_images().value();
-		vk_swapchain_image_views = swapchain.get_image_views().value();
-
 		veekay::app.vk_device = vk_device;
 		veekay::app.vk_physical_device = vk_physical_device;
-	}
-
-	graphics::init();
 
-	{ // NOTE: ImGui initialization
-		IMGUI_CHECKVERSION();
-		ImGui::CreateContext();
-		ImGuiIO& io = ImGui::GetIO(); (void)io;
+		// NOTE: Device is created for Vulkan 1.2, so extension entry points are loaded by hand
+		vk_begin_rendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(
+			vkGetDeviceProcAddr(vk_device, "vkCmdBeginRenderingKHR"));
+		vk_end_rendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(
+			vkGetDeviceProcAddr(vk_device, "vkCmdEndRenderingKHR"));
 
-		ImGui::StyleColorsDark();
+		// NOTE: Offscreen images need the allocator
+		graphics::init(vk_memory_budget);
+		graphics::profiler::init(vk_graphics_queue_family);
 
-		ImGui_ImplGlfw_InitForVulkan(window, true);
+		veekay::app.vk_pipeline_cache = graphics::pipeline_cache::load(pipeline_cache_path);
 
-		{
-			VkDescriptorPoolSize size = {
-				.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				.descriptorCount = IMGUI_IMPL_VULKAN_MINIMUM_IMAGE_SAMPLER_POOL_SIZE,
-			};
-
-			VkDescriptorPoolCreateInfo info = {
-				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-				.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
-				.maxSets = size.descriptorCount,
-				.poolSizeCount = 1,
-				.pPoolSizes = &size,
-			};
+		vk_swapchain_format = VK_FORMAT_B8G8R8A8_UNORM;
+		veekay::app.vk_color_format = vk_swapchain_format;
 
-			if (vkCreateDescriptorPool(vk_device, &info, 0, &imgui_descriptor_pool) != VK_SUCCESS) {
-				std::cerr << "Failed to create Vulkan descriptor pool for ImGui\n";
-				return 1;
-			}
-		}
+		if (!headless) {
+			vkb::SwapchainBuilder swapchain_builder(vk_physical_device, vk_device, vk_surface);
 
-		{
-			VkAttachmentDescription attachment{
+			VkSurfaceFormatKHR surface_format{
 				.format = vk_swapchain_format,
-				.samples = VK_SAMPLE_COUNT_1_BIT,
-				.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
-				.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-				.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-				.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				.initialLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-				.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+				.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
 			};
 
-			VkAttachmentReference ref{
-				.attachment = 0,
-				.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			};
-
-			VkSubpassDescription subpass{
-				.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
-				.colorAttachmentCount = 1,
-				.pColorAttachments = &ref,
-			};
+			auto swapchain_result = swapchain_builder.set_desired_format(surface_format)
+			                                         .set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
+			                                         .set_desired_extent(app.window_width, app.window_height)
+			                                         .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+			                                         .build();
 
-			VkSubpassDependency dependency{
-				.srcSubpass = VK_SUBPASS_EXTERNAL,
-				.dstSubpass = 0,
-				.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-				.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-				.srcAccessMask = 0,
-				.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-			};
-
-			VkRenderPassCreateInfo info{
-				.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
-				.attachmentCount = 1,
-				.pAttachments = &attachment,
-				.subpassCount = 1,
-				.pSubpasses = &subpass,
-				.dependencyCount = 1,
-				.pDependencies = &dependency,
-			};
-
-			if (vkCreateRenderPass(vk_device, &info, nullptr, &imgui_render_pass) != VK_SUCCESS) {
-				std::cerr << "Failed to create ImGui Vulkan render pass\n";
+			if (!swapchain_result) {
+				std::cerr << swapchain_result.error().message() << '\n';
 				return 1;
 			}
-		}
-
-		{
-			VkFramebufferCreateInfo info{
-				.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-				.renderPass = imgui_render_pass,
-				.attachmentCount = 1,
-				.width = app.window_width,
-				.height = app.window_height,
-				.layers = 1,
-			};
-
-			const size_t count = vk_swapchain_images.size();
-
-			imgui_framebuffers.resize(count);
 
-			for (size_t i = 0; i < count; ++i) {
-				info.pAttachments = &vk_swapchain_image_views[i];
-				if (vkCreateFramebuffer(vk_device, &info, nullptr, &imgui_framebuffers[i]) != VK_SUCCESS) {
-					std::cerr << "Failed to create Vulkan framebuffer " << i << '\n';
-					return 1;
+			auto swapchain = swapchain_result.value();
+
+			vk_swapchain = swapchain.swapchain;
+			vk_swapchain_images = swapchain.get_images().value();
+			vk_swapchain_image_views = swapchain.get_image_views().value();
+		} else {
+			// NOTE: One offscreen image per frame in flight, so waiting
+			//       for frame slot also guards reuse of its image
+			vk_swapchain_images.resize(max_frames_in_flight);
+			vk_swapchain_image_views.resize(max_frames_in_flight);
+			offscreen_allocations.resize(max_frames_in_flight);
+
+			for (uint32_t i = 0; i < max_frames_in_flight; ++i) {
+				{
+					VkImageCreateInfo info{
+						.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+						.imageType = VK_IMAGE_TYPE_2D,
+						.format = vk_swapchain_format,
+						.extent = {app.window_width, app.window_height, 1},
+						.mipLevels = 1,
+						.arrayLayers = 1,
+						.samples = VK_SAMPLE_COUNT_1_BIT,
+						.tiling = VK_IMAGE_TILING_OPTIMAL,
+						.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+						         VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+						         VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+					};
+
+					if (vkCreateImage(vk_device, &info, nullptr, &vk_swapchain_images[i]) != VK_SUCCESS) {
+						std::cerr << "Failed to create Vulkan offscreen image\n";
+						return 1;
+					}
 				}
-			}
-		}
-
-		{
-			size_t count = imgui_framebuffers.size();
-
-			imgui_command_buffers.resize(count);
 
-			{
-				VkCommandPoolCreateInfo info{
-					.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-					.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-					.queueFamilyIndex = vk_graphics_queue_family,
-				};
+				{
+					VkMemoryRequirements requirements;
+					vkGetImageMemoryRequirements(vk_device, vk_swapchain_images[i], &requirements);
+
+					try {
+						offscreen_allocations[i] = graphics::memory::allocate(requirements,
+						                                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+						                                                      0, false,
+						                                                      graphics::MemoryCategory::attachment);
+					} catch (const std::exception& e) {
+						std::cerr << e.what() << '\n';
+						return 1;
+					}
+
+					if (vkBindImageMemory(vk_device, vk_swapchain_images[i], offscreen_allocations[i].memory,
+					                      offscreen_allocations[i].offset) != VK_SUCCESS) {
+						std::cerr << "Failed to bind Vulkan offscreen image with device memory\n";
+						return 1;
+					}
+				}
 
-				if (vkCreateCommandPool(vk_device, &info, nullptr, &imgui_command_pool) != VK_SUCCESS) {
-					std::cerr << "Failed to create ImGui Vulkan command pool\n";
-					return 1;
+				{
+					VkImageViewCreateInfo info{
+						.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+						.image = vk_swapchain_images[i],
+						.viewType = VK_IMAGE_VIEW_TYPE_2D,
+						.format = vk_swapchain_format,
+						.subresourceRange = {
+							.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+							.baseMipLevel = 0,
+							.levelCount = 1,
+							.baseArrayLayer = 0,
+							.layerCount = 1,
+						},
+					};
+
+					if (vkCreateImageView(vk_device, &info, nullptr, &vk_swapchain_image_views[i]) != VK_SUCCESS) {
+						std::cerr << "Failed to create Vulkan offscreen image view\n";
+						return 1;
+					}
 				}
 			}
 
-			{
-				VkCommandBufferAllocateInfo info{
-					.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-					.commandPool = imgui_command_pool,
-					.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-					.commandBufferCount = static_cast<uint32_t>(imgui_command_buffers.size()),
-				};
+			if (app_info.headless.capture_path && app_info.headless.capture_interval > 0) {
+				const VkDeviceSize capture_size = VkDeviceSize(app.window_width) * app.window_height * 4;
 
-				if (vkAllocateCommandBuffers(vk_device, &info, imgui_command_buffers.data()) != VK_SUCCESS) {
-					std::cerr << "Failed to allocate ImGui Vulkan command buffers\n";
-					return 1;
-				}
+				capture_buffer = new graphics::Buffer(capture_size, nullptr,
+				                                      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				                                      graphics::MemoryUsage::readback);
 			}
 		}
-
-		ImGui_ImplVulkan_InitInfo info{
-			.Instance = vk_instance,
-			.PhysicalDevice = vk_physical_device,
-			.Device = vk_device,
-			.QueueFamily = vk_graphics_queue_family,
-			.Queue = vk_graphics_queue,
-			.DescriptorPool = imgui_descriptor_pool,
-			.MinImageCount = static_cast<uint32_t>(vk_swapchain_images.size()),
-			.ImageCount = static_cast<uint32_t>(vk_swapchain_images.size()),
-			.RenderPass = imgui_render_pass,
-		};
-
-		ImGui_ImplVulkan_Init(&info);
 	}
 
 	{
@@ -384,6 +479,8 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 				break;
 			}
 		}
+
+		veekay::app.vk_depth_format = vk_image_depth_format;
 	}
 
 	{ // NOTE: Create depth buffer
@@ -399,6 +496,10 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
 		};
 
+		if (vk_image_depth_transient) {
+			info.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+
 		if (vkCreateImage(vk_device, &info, nullptr, &vk_image_depth) != VK_SUCCESS) {
 			std::cerr << "Failed to create Vulkan depth image\n";
 			return 1;
@@ -409,37 +510,20 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		VkMemoryRequirements requirements;
 		vkGetImageMemoryRequirements(vk_device, vk_image_depth, &requirements);
 
-		VkPhysicalDeviceMemoryProperties properties;
-		vkGetPhysicalDeviceMemoryProperties(vk_physical_device, &properties);
-
-		uint32_t index = UINT_MAX;
-		for (uint32_t i = 0; i < properties.memoryTypeCount; ++i) {
-			const VkMemoryType& type = properties.memoryTypes[i];
-
-			if ((requirements.memoryTypeBits & (1 << i)) &&
-			    (type.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
-				index = i;
-				break;
-			}
-		}
-
-		if (index == UINT_MAX) {
-			std::cerr << "Failed to find required memory type for Vulkan depth image\n";
-			return 1;
-		}
-
-		VkMemoryAllocateInfo info = {
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-			.allocationSize = requirements.size,
-			.memoryTypeIndex = index,
-		};
-
-		if (vkAllocateMemory(vk_device, &info, nullptr, &vk_image_depth_memory) != VK_SUCCESS) {
-			std::cerr << "Failed to allocate memory for Vulkan depth image\n";
+		// NOTE: Lazily allocated memory types are offered only for transient images
+		try {
+			vk_image_depth_allocation = graphics::memory::allocate(requirements,
+			                                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			                                                       VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+			                                                       false,
+			                                                       graphics::MemoryCategory::attachment);
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
 			return 1;
 		}
 
-		if (vkBindImageMemory(vk_device, vk_image_depth, vk_image_depth_memory, 0) != VK_SUCCESS) {
+		if (vkBindImageMemory(vk_device, vk_image_depth, vk_image_depth_allocation.memory,
+		                      vk_image_depth_allocation.offset) != VK_SUCCESS) {
 			std::cerr << "Failed to bind Vulkan depth image with device memory\n";
 			return 1;
 		}
@@ -466,7 +550,7 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		}
 	}
 
-	{ // NOTE: Create render pass
+	if (!dynamic_rendering) { // NOTE: Create render pass
 		VkAttachmentDescription color_attachment{
 			.format = vk_swapchain_format,
 
@@ -479,14 +563,15 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 
 			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-			.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			.finalLayout = vk_present_layout,
 		};
 
 		VkAttachmentDescription depth_attachment{
 			.format = vk_image_depth_format,
 			.samples = VK_SAMPLE_COUNT_1_BIT,
 			.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-			.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+			.storeOp = vk_image_depth_transient ? VK_ATTACHMENT_STORE_OP_DONT_CARE :
+			                                      VK_ATTACHMENT_STORE_OP_STORE,
 			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
 			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
@@ -503,37 +588,59 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
 		};
 
-		VkSubpassDescription subpass{
-			.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
-			.colorAttachmentCount = 1,
-			.pColorAttachments = &color_ref,
-			.pDepthStencilAttachment = &depth_ref,
+		// NOTE: UI subpass draws over scene while color stays in tile memory
+		VkSubpassDescription subpasses[] = {
+			{
+				.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+				.colorAttachmentCount = 1,
+				.pColorAttachments = &color_ref,
+				.pDepthStencilAttachment = &depth_ref,
+			},
+			{
+				.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+				.colorAttachmentCount = 1,
+				.pColorAttachments = &color_ref,
+			},
 		};
 
 		VkAttachmentDescription attachments[] = {color_attachment, depth_attachment};
 
-		VkSubpassDependency dependency{
-			.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-			                VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-			.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-			                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-			.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-			.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
-			                 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-			.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
+		VkSubpassDependency dependencies[] = {
+			{
+				.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+				                VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+				.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+				                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+				.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+				                 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
+			},
+			{
+				.srcSubpass = 0,
+				.dstSubpass = 1,
+				.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+				                 VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
+			},
 		};
 
+		const uint32_t subpass_count = integrated_ui ? 2 : 1;
+
 		VkRenderPassCreateInfo info{
 			.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
 
 			.attachmentCount = 2,
 			.pAttachments = attachments,
 
-			.subpassCount = 1,
-			.pSubpasses = &subpass,
+			.subpassCount = subpass_count,
+			.pSubpasses = subpasses,
 
-			.dependencyCount = 1,
-			.pDependencies = &dependency,
+			.dependencyCount = subpass_count,
+			.pDependencies = dependencies,
 		};
 
 		if (vkCreateRenderPass(vk_device, &info, nullptr, &vk_render_pass) != VK_SUCCESS) {
@@ -544,7 +651,7 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		veekay::app.vk_render_pass = vk_render_pass;
 	}
 
-	{ // NOTE: Create framebuffer objects from swapchain images
+	if (!dynamic_rendering) { // NOTE: Create framebuffer objects from swapchain images
 		VkImageView attachments[] = {VK_NULL_HANDLE, vk_image_depth_view};
 
 		VkFramebufferCreateInfo info{
@@ -573,12 +680,162 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		}
 	}
 
+	{ // NOTE: ImGui initialization
+		IMGUI_CHECKVERSION();
+		ImGui::CreateContext();
+		ImGuiIO& io = ImGui::GetIO(); (void)io;
+
+		ImGui::StyleColorsDark();
+
+		ImGui_ImplGlfw_InitForVulkan(window, true);
+
+		{
+			VkDescriptorPoolSize size = {
+				.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.descriptorCount = IMGUI_IMPL_VULKAN_MINIMUM_IMAGE_SAMPLER_POOL_SIZE,
+			};
+
+			VkDescriptorPoolCreateInfo info = {
+				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+				.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+				.maxSets = size.descriptorCount,
+				.poolSizeCount = 1,
+				.pPoolSizes = &size,
+			};
+
+			if (vkCreateDescriptorPool(vk_device, &info, 0, &imgui_descriptor_pool) != VK_SUCCESS) {
+				std::cerr << "Failed to create Vulkan descriptor pool for ImGui\n";
+				return 1;
+			}
+		}
+
+		// NOTE: Separate UI pass loads and stores color image once more,
+		//       with dynamic rendering it needs no render pass object
+		if (!integrated_ui && !dynamic_rendering) {
+			{
+				VkAttachmentDescription attachment{
+					.format = vk_swapchain_format,
+					.samples = VK_SAMPLE_COUNT_1_BIT,
+					.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+					.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+					.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+					.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+					.initialLayout = vk_present_layout,
+					.finalLayout = vk_present_layout,
+				};
+
+				VkAttachmentReference ref{
+					.attachment = 0,
+					.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				};
+
+				VkSubpassDescription subpass{
+					.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+					.colorAttachmentCount = 1,
+					.pColorAttachments = &ref,
+				};
+
+				VkSubpassDependency dependency{
+					.srcSubpass = VK_SUBPASS_EXTERNAL,
+					.dstSubpass = 0,
+					.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+					.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+					.srcAccessMask = 0,
+					.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				};
+
+				VkRenderPassCreateInfo info{
+					.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+					.attachmentCount = 1,
+					.pAttachments = &attachment,
+					.subpassCount = 1,
+					.pSubpasses = &subpass,
+					.dependencyCount = 1,
+					.pDependencies = &dependency,
+				};
+
+				if (vkCreateRenderPass(vk_device, &info, nullptr, &imgui_render_pass) != VK_SUCCESS) {
+					std::cerr << "Failed to create ImGui Vulkan render pass\n";
+					return 1;
+				}
+			}
+
+			{
+				VkFramebufferCreateInfo info{
+					.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+					.renderPass = imgui_render_pass,
+					.attachmentCount = 1,
+					.width = app.window_width,
+					.height = app.window_height,
+					.layers = 1,
+				};
+
+				const size_t count = vk_swapchain_images.size();
+
+				imgui_framebuffers.resize(count);
+
+				for (size_t i = 0; i < count; ++i) {
+					info.pAttachments = &vk_swapchain_image_views[i];
+					if (vkCreateFramebuffer(vk_device, &info, nullptr, &imgui_framebuffers[i]) != VK_SUCCESS) {
+						std::cerr << "Failed to create Vulkan framebuffer " << i << '\n';
+						return 1;
+					}
+				}
+			}
+		}
+
+		ImGui_ImplVulkan_InitInfo info{
+			.Instance = vk_instance,
+			.PhysicalDevice = vk_physical_device,
+			.Device = vk_device,
+			.QueueFamily = vk_graphics_queue_family,
+			.Queue = vk_graphics_queue,
+			.DescriptorPool = imgui_descriptor_pool,
+			.MinImageCount = static_cast<uint32_t>(vk_swapchain_images.size()),
+			.ImageCount = static_cast<uint32_t>(vk_swapchain_images.size()),
+			.RenderPass = integrated_ui ? vk_render_pass : imgui_render_pass,
+		};
+
+		info.Subpass = integrated_ui ? 1 : 0;
+
+		// NOTE: Loaded before ImGui, so its shaders aren't compiled on every launch either
+		info.PipelineCache = veekay::app.vk_pipeline_cache;
+
+		// NOTE: Integrated UI is drawn inside scene rendering with depth bound, so
+		//       the pipeline has to match depth format as well, see renderImGui
+		if (dynamic_rendering) {
+			info.Subpass = 0;
+			info.UseDynamicRendering = true;
+			info.PipelineRenderingCreateInfo = VkPipelineRenderingCreateInfoKHR{
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR,
+				.colorAttachmentCount = 1,
+				.pColorAttachmentFormats = &vk_swapchain_format,
+				.depthAttachmentFormat = integrated_ui ? vk_image_depth_format : VK_FORMAT_UNDEFINED,
+			};
+		}
+
+		ImGui_ImplVulkan_Init(&info);
+	}
+
 	{ // NOTE: Create sync primitives
-		VkFenceCreateInfo fence_info{
-			.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-			.flags = VK_FENCE_CREATE_SIGNALED_BIT,
+		VkSemaphoreTypeCreateInfo timeline_info{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+			.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+			.initialValue = 0,
 		};
 
+		VkSemaphoreCreateInfo timeline_sem_info{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+			.pNext = &timeline_info,
+		};
+
+		if (vkCreateSemaphore(vk_device, &timeline_sem_info, nullptr, &vk_frame_timeline) != VK_SUCCESS) {
+			std::cerr << "Failed to create Vulkan timeline semaphore\n";
+			return 1;
+		}
+
+		veekay::app.vk_frame_timeline = vk_frame_timeline;
+
 		VkSemaphoreCreateInfo sem_info{
 			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
 		};
@@ -590,47 +847,53 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		}
 
 		vk_render_semaphores.resize(max_frames_in_flight);
-		vk_in_flight_fences.resize(max_frames_in_flight);
 
 		for (uint32_t i = 0; i < max_frames_in_flight; ++i) {
 			vkCreateSemaphore(vk_device, &sem_info, nullptr, &vk_render_semaphores[i]);
-			vkCreateFence(vk_device, &fence_info, nullptr, &vk_in_flight_fences[i]);
 		}
 	}
 
-	{ // NOTE: Create command pool from graphics queue
+	{ // NOTE: Create command pool per frame in flight from graphics queue
 		VkCommandPoolCreateInfo info{
 			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-			.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+			.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
 			.queueFamilyIndex = vk_graphics_queue_family,
 		};
 
-		if (vkCreateCommandPool(vk_device, &info, nullptr, &vk_command_pool) != VK_SUCCESS) {
-			std::cerr << "Failed to create Vulkan command pool\n";
-			return 1;
+		vk_command_pools.resize(max_frames_in_flight);
+
+		for (uint32_t i = 0; i < max_frames_in_flight; ++i) {
+			if (vkCreateCommandPool(vk_device, &info, nullptr, &vk_command_pools[i]) != VK_SUCCESS) {
+				std::cerr << "Failed to create Vulkan command pool\n";
+				return 1;
+			}
 		}
 	}
 
-	{ // NOTE: Allocate command buffers
-		vk_command_buffers.resize(vk_framebuffers.size());
-		
-		VkCommandBufferAllocateInfo info{
-			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-			.commandPool = vk_command_pool,
-			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-			.commandBufferCount = static_cast<uint32_t>(vk_command_buffers.size()),
-		};
+	{ // NOTE: Allocate renderer and ImGui command buffers for every frame slot
+		vk_command_buffers.resize(max_frames_in_flight);
+		imgui_command_buffers.resize(max_frames_in_flight);
 
-		if (vkAllocateCommandBuffers(vk_device, &info, vk_command_buffers.data()) != VK_SUCCESS) {
-			std::cerr << "Failed to allocate Vulkan command buffers\n";
-			return 1;
+		for (uint32_t i = 0; i < max_frames_in_flight; ++i) {
+			VkCommandBufferAllocateInfo info{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+				.commandPool = vk_command_pools[i],
+				.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+				.commandBufferCount = 1,
+			};
+
+			if (vkAllocateCommandBuffers(vk_device, &info, &vk_command_buffers[i]) != VK_SUCCESS ||
+			    vkAllocateCommandBuffers(vk_device, &info, &imgui_command_buffers[i]) != VK_SUCCESS) {
+				std::cerr << "Failed to allocate Vulkan command buffers\n";
+				return 1;
+			}
 		}
 	}
 
 	VkCommandBuffer onetime_command_buffer; {
 		VkCommandBufferAllocateInfo info{
 			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-			.commandPool = vk_command_pool,
+			.commandPool = vk_command_pools[0],
 			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
 			.commandBufferCount = 1,
 		};
@@ -650,6 +913,15 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		vkBeginCommandBuffer(onetime_command_buffer, &info);
 	}
 
+	// NOTE: Started after the last early return, so that
+	//       no error path leaves worker threads running
+	jobs::init();
+	graphics::recording::init(vk_graphics_queue_family);
+
+	// NOTE: Pipelines are usually created here, compare
+	//       this time between runs with and without the cache
+	const double init_start_time = glfwGetTime();
+
 	app_info.init(onetime_command_buffer);
 
 	{
@@ -664,40 +936,123 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 		vkQueueSubmit(vk_graphics_queue, 1, &info, VK_NULL_HANDLE);
 		vkQueueWaitIdle(vk_graphics_queue);
 
-		vkFreeCommandBuffers(vk_device, vk_command_pool, 1, &onetime_command_buffer);
+		vkFreeCommandBuffers(vk_device, vk_command_pools[0], 1, &onetime_command_buffer);
+
+		graphics::finishUploads();
+
+		std::cout << "Application initialization took "
+		          << (glfwGetTime() - init_start_time) * 1000.0 << " ms\n";
 	}
 
-	while (veekay::app.running && !glfwWindowShouldClose(window)) {
-		veekay::input::cache();
-		
+	simulation::init(app_info.simulation);
+
+	// NOTE: Zero frame limit runs until application stops
+	const uint32_t frame_limit = headless ? app_info.headless.frames : 0;
+	uint32_t frame_count = 0;
+
+	const double loop_start_time = glfwGetTime();
+	double input_latency_total = 0.0;
+	uint64_t attachment_passes_total = 0;
+	uint64_t attachment_traffic_total = 0;
+
+	while (veekay::app.running && !glfwWindowShouldClose(window) &&
+	       (frame_limit == 0 || frame_count < frame_limit)) {
+		trace::frameMark();
+
+		trace::begin("glfwPollEvents");
 		glfwPollEvents();
+		veekay::input::newFrame();
 		double time = glfwGetTime();
+		trace::end();
 
+		// NOTE: Time of input this frame's camera is made from
+		double input_time = time;
+
+		app.frame_number = frame_count + 1;
+
+		// NOTE: Wait until GPU finishes the frame which used this slot last,
+		//       after that its command buffers and per-frame data are free
+		trace::begin("Frame wait");
+		if (app.frame_number > max_frames_in_flight) {
+			graphics::waitForFrame(app.frame_number - max_frames_in_flight);
+		}
+		graphics::retireFrame(graphics::completedFrame());
+		trace::end();
+
+		vkResetCommandPool(vk_device, vk_command_pools[vk_current_frame], 0);
+
+		app.frame_index = vk_current_frame;
+
+		graphics::profiler::newFrame();
+		graphics::recording::newFrame();
+		simulation::newFrame();
+
+		trace::begin("ImGui::NewFrame");
 		ImGui_ImplVulkan_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
+		trace::end();
 
+		trace::begin("update");
 		app_info.update(time);
+		trace::end();
 
+		trace::begin("ImGui::Render");
 		ImGui::Render();
+		trace::end();
+
+		// NOTE: Get current swapchain framebuffer index,
+		//       headless mode has an offscreen image per frame slot
+		uint32_t swapchain_image_index = vk_current_frame;
+		if (!headless) {
+			trace::Scope scope("vkAcquireNextImageKHR");
+			vkAcquireNextImageKHR(vk_device, vk_swapchain, UINT64_MAX,
+			                      vk_render_semaphores[vk_current_frame],
+			                      nullptr, &swapchain_image_index);
+		}
+
+		const bool capture = capture_buffer &&
+		                     (frame_count + 1) % app_info.headless.capture_interval == 0;
 
-		// NOTE: Wait until the previous frame finishes
-		vkWaitForFences(vk_device, 1, &vk_in_flight_fences[vk_current_frame], true, UINT64_MAX);
-		vkResetFences(vk_device, 1, &vk_in_flight_fences[vk_current_frame]);
+		VkCommandBuffer cmd = vk_command_buffers[vk_current_frame];
 
-		// NOTE: Get current swapchain framebuffer index
-		uint32_t swapchain_image_index = 0;
-		vkAcquireNextImageKHR(vk_device, vk_swapchain, UINT64_MAX,
-		                      vk_render_semaphores[vk_current_frame],
-		                      nullptr, &swapchain_image_index);
+		app.attachment_passes = 0;
+		app.attachment_traffic = 0;
 
-		VkCommandBuffer cmd = vk_command_buffers[swapchain_image_index];
+		// NOTE: Swapchain formats take four bytes per texel
+		const VkDeviceSize color_size = VkDeviceSize(app.window_width) * app.window_height * 4;
 
-		app_info.render(cmd, vk_framebuffers[swapchain_image_index]);
+		trace::begin("render");
+		if (dynamic_rendering) {
+			RenderTarget target{
+				.extent = {app.window_width, app.window_height},
+				.color_image = vk_swapchain_images[swapchain_image_index],
+				.color_view = vk_swapchain_image_views[swapchain_image_index],
+				.color_final_layout = vk_present_layout,
+				.depth_image = vk_image_depth,
+				.depth_view = vk_image_depth_view,
+				.depth_store_op = vk_image_depth_transient ? VK_ATTACHMENT_STORE_OP_DONT_CARE :
+				                                             VK_ATTACHMENT_STORE_OP_STORE,
+			};
+
+			app_info.render_dynamic(cmd, target);
+		} else {
+			app_info.render(cmd, vk_framebuffers[swapchain_image_index]);
 
-		VkCommandBuffer imgui_cmd = imgui_command_buffers[swapchain_image_index];
-		{ // NOTE: Draw ImGui
-			vkResetCommandBuffer(imgui_cmd, 0);
+			// NOTE: Render callback begins app.vk_render_pass, which clears both
+			//       attachments and stores color, and depth unless it is transient
+			++app.attachment_passes;
+			app.attachment_traffic += color_size + (vk_image_depth_transient ? 0 : vk_image_depth_allocation.size);
+		}
+		trace::end();
+
+		// NOTE: Integrated UI is already drawn by render callback,
+		//       then second command buffer is needed only for capture
+		const bool record_post = !integrated_ui || capture;
+
+		VkCommandBuffer post_cmd = imgui_command_buffers[vk_current_frame];
+		if (record_post) {
+			trace::Scope scope(integrated_ui ? "Capture recording" : "ImGui recording");
 
 			{
 				VkCommandBufferBeginInfo info{
@@ -705,10 +1060,73 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 					.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
 				};
 
-				vkBeginCommandBuffer(imgui_cmd, &info);
+				vkBeginCommandBuffer(post_cmd, &info);
 			}
 
-			{
+			if (!integrated_ui && dynamic_rendering) { // NOTE: Draw ImGui over finished frame
+				VkImageMemoryBarrier barrier{
+					.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+					.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+					.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+					                 VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+					.oldLayout = vk_present_layout,
+					.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.image = vk_swapchain_images[swapchain_image_index],
+					.subresourceRange = {
+						.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+						.baseMipLevel = 0,
+						.levelCount = 1,
+						.baseArrayLayer = 0,
+						.layerCount = 1,
+					},
+				};
+
+				vkCmdPipelineBarrier(post_cmd,
+				                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+				VkRenderingAttachmentInfoKHR attachment{
+					.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+					.imageView = vk_swapchain_image_views[swapchain_image_index],
+					.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+					.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+				};
+
+				VkRenderingInfoKHR info{
+					.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
+					.renderArea = {
+						.extent = {app.window_width, app.window_height},
+					},
+					.layerCount = 1,
+					.colorAttachmentCount = 1,
+					.pColorAttachments = &attachment,
+				};
+
+				// NOTE: Color is loaded and stored once more
+				++app.attachment_passes;
+				app.attachment_traffic += 2 * color_size;
+
+				graphics::profiler::begin(post_cmd, "UI pass");
+				vk_begin_rendering(post_cmd, &info);
+				renderImGui(post_cmd);
+				vk_end_rendering(post_cmd);
+				graphics::profiler::end(post_cmd);
+
+				// NOTE: Capture copy below waits for transfer stage
+				barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+				barrier.dstAccessMask = headless ? VkAccessFlags(VK_ACCESS_TRANSFER_READ_BIT) : 0;
+				barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				barrier.newLayout = vk_present_layout;
+
+				vkCmdPipelineBarrier(post_cmd,
+				                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				                     headless ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+				                     0, 0, nullptr, 0, nullptr, 1, &barrier);
+			} else if (!integrated_ui) { // NOTE: Draw ImGui
 				VkRenderPassBeginInfo info{
 					.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
 					.renderPass = imgui_render_pass,
@@ -718,35 +1136,126 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 					},
 				};
 
-				vkCmdBeginRenderPass(imgui_cmd, &info, VK_SUBPASS_CONTENTS_INLINE);
+				++app.attachment_passes;
+				app.attachment_traffic += 2 * color_size;
+
+				graphics::profiler::begin(post_cmd, "UI pass");
+				vkCmdBeginRenderPass(post_cmd, &info, VK_SUBPASS_CONTENTS_INLINE);
+				renderImGui(post_cmd);
+				vkCmdEndRenderPass(post_cmd);
+				graphics::profiler::end(post_cmd);
 			}
 
-			ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), imgui_cmd);
+			if (capture) { // NOTE: Copy finished frame into readback buffer
+				VkMemoryBarrier barrier{
+					.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+					.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+					.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+				};
+
+				vkCmdPipelineBarrier(post_cmd,
+				                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+				                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+				VkBufferImageCopy region{
+					.imageSubresource = {
+						.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+						.mipLevel = 0,
+						.baseArrayLayer = 0,
+						.layerCount = 1,
+					},
+					.imageExtent = {app.window_width, app.window_height, 1},
+				};
+
+				vkCmdCopyImageToBuffer(post_cmd, vk_swapchain_images[swapchain_image_index],
+				                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				                       capture_buffer->buffer, 1, &region);
+
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
 
-			vkCmdEndRenderPass(imgui_cmd);
-			vkEndCommandBuffer(imgui_cmd);
+				vkCmdPipelineBarrier(post_cmd,
+				                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+				                     VK_PIPELINE_STAGE_HOST_BIT,
+				                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+			}
+
+			vkEndCommandBuffer(post_cmd);
 		}
 
+		if (app_info.late_latch) { // NOTE: Latest input goes into uniforms just before submission
+			trace::Scope scope("Late latch");
+
+			glfwPollEvents();
+			veekay::input::latch();
+			input_time = glfwGetTime();
+
+			app_info.late_latch();
+		}
+
+		app.input_latency = glfwGetTime() - input_time;
+		input_latency_total += app.input_latency;
+
+		attachment_passes_total += app.attachment_passes;
+		attachment_traffic_total += app.attachment_traffic;
+
 		{ // NOTE: Submit commands to graphics queue
+			trace::Scope scope("vkQueueSubmit");
+
 			VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
-			VkCommandBuffer buffers[] = { cmd, imgui_cmd };
+			VkCommandBuffer buffers[] = { cmd, post_cmd };
+
+			VkSemaphore signal_semaphores[] = {
+				vk_frame_timeline,
+				vk_present_semaphores[swapchain_image_index],
+			};
+
+			// NOTE: Value of binary semaphore is ignored
+			uint64_t signal_values[] = {app.frame_number, 0};
+
+			// NOTE: Offscreen images are neither acquired nor presented
+			const uint32_t signal_count = headless ? 1u : 2u;
+
+			VkTimelineSemaphoreSubmitInfo timeline_info{
+				.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+				.signalSemaphoreValueCount = signal_count,
+				.pSignalSemaphoreValues = signal_values,
+			};
 
 			VkSubmitInfo info{
 				.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-				.waitSemaphoreCount = 1,
+				.pNext = &timeline_info,
+				.waitSemaphoreCount = headless ? 0u : 1u,
 				.pWaitSemaphores = &vk_render_semaphores[vk_current_frame],
 				.pWaitDstStageMask = &wait_stage,
-				.commandBufferCount = 2,
+				.commandBufferCount = record_post ? 2u : 1u,
 				.pCommandBuffers = buffers,
-				.signalSemaphoreCount = 1,
-				.pSignalSemaphores = &vk_present_semaphores[swapchain_image_index],
+				.signalSemaphoreCount = signal_count,
+				.pSignalSemaphores = signal_semaphores,
 			};
 
-			vkQueueSubmit(vk_graphics_queue, 1, &info, vk_in_flight_fences[vk_current_frame]);
+			vkQueueSubmit(vk_graphics_queue, 1, &info, VK_NULL_HANDLE);
+			graphics::submitFrame(app.frame_number);
+		}
+
+		if (capture) { // NOTE: Capture stalls until this frame completes
+			trace::Scope scope("Capture");
+
+			graphics::waitForFrame(app.frame_number);
+
+			char path[512];
+			snprintf(path, sizeof(path), app_info.headless.capture_path, frame_count);
+
+			if (!writeCapture(path, capture_buffer->mapped_region, app.window_width, app.window_height)) {
+				std::cerr << "Failed to write frame capture to " << path << '\n';
+			}
 		}
 
-		{ // NOTE: Present renderer frame
+		if (!headless) { // NOTE: Present renderer frame
+			trace::Scope scope("vkQueuePresentKHR");
+
 			VkPresentInfoKHR info{
 				.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
 				.waitSemaphoreCount = 1,
@@ -757,16 +1266,71 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 			};
 
 			vkQueuePresentKHR(vk_graphics_queue, &info);
-
-			vk_current_frame = (vk_current_frame + 1) % max_frames_in_flight;
 		}
+
+		vk_current_frame = (vk_current_frame + 1) % max_frames_in_flight;
+		++frame_count;
 	}
 
+	// NOTE: Ticks may run jobs, so it stops before the scheduler
+	simulation::shutdown();
+
 	vkDeviceWaitIdle(vk_device);
 
+	if (headless) {
+		const double elapsed = glfwGetTime() - loop_start_time;
+
+		std::cout << "Rendered " << frame_count << " frames in " << elapsed << " s ("
+		          << (elapsed > 0.0 ? frame_count / elapsed : 0.0) << " frames per second, "
+		          << (frame_count > 0 ? elapsed * 1000.0 / frame_count : 0.0) << " ms per frame)\n";
+
+		const double frames = frame_count > 0 ? double(frame_count) : 1.0;
+
+		// NOTE: Estimate from load and store ops of rendering actually recorded
+		std::cout << "Attachment traffic: " << double(attachment_traffic_total) / frames / (1024.0 * 1024.0)
+		          << " MiB per frame in " << double(attachment_passes_total) / frames
+		          << " rendering passes (estimated from load and store ops)\n";
+
+		const VkMemoryPropertyFlags depth_memory_flags =
+			graphics::memory::properties().memoryTypes[vk_image_depth_allocation.memory_type].propertyFlags;
+
+		std::cout << "Depth attachment: " << (vk_image_depth_transient ? "transient" : "stored") << ", "
+		          << ((depth_memory_flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) ? "lazily allocated" : "device local")
+		          << " memory\n";
+
+		// NOTE: Measured, sum of top level scopes is the same span whether UI
+		//       has a pass of its own or is drawn along with scene
+		if (graphics::profiler::supported()) {
+			double gpu_time = 0.0;
+			uint32_t samples = 0;
+
+			for (const graphics::profiler::ScopeStats& stats : graphics::profiler::results()) {
+				if (stats.depth == 0) {
+					gpu_time += stats.average;
+					samples = std::max(samples, stats.samples);
+				}
+			}
+
+			std::cout << "GPU time: " << gpu_time << " ms per frame (top level profiler scopes, average of last "
+			          << samples << " frames)\n";
+		}
+
+		std::cout << "Input to submit latency: "
+		          << (frame_count > 0 ? input_latency_total * 1000.0 / frame_count : 0.0)
+		          << " ms average (" << (app_info.late_latch ? "late latched" : "polled at frame start") << ")\n";
+	}
+
+	// NOTE: Finishes jobs still queued, afterwards jobs run inline
+	jobs::shutdown();
+
 	app_info.shutdown();
 
-	vkDestroyCommandPool(vk_device, vk_command_pool, nullptr);
+	graphics::pipeline_cache::save(app.vk_pipeline_cache, pipeline_cache_path);
+	vkDestroyPipelineCache(vk_device, app.vk_pipeline_cache, nullptr);
+
+	for (size_t i = 0; i < max_frames_in_flight; ++i) {
+		vkDestroyCommandPool(vk_device, vk_command_pools[i], nullptr);
+	}
 
 	for (size_t i = 0, e = vk_swapchain_images.size(); i != e; ++i) {
 		vkDestroySemaphore(vk_device, vk_present_semaphores[i], nullptr);
@@ -774,22 +1338,37 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 
 	for (size_t i = 0; i < max_frames_in_flight; ++i) {
 		vkDestroySemaphore(vk_device, vk_render_semaphores[i], nullptr);
-		vkDestroyFence(vk_device, vk_in_flight_fences[i], nullptr);
 	}
+
+	vkDestroySemaphore(vk_device, vk_frame_timeline, nullptr);
 	
 	vkDestroyRenderPass(vk_device, vk_render_pass, nullptr);
 
 	vkDestroyImageView(vk_device, vk_image_depth_view, nullptr);
-	vkFreeMemory(vk_device, vk_image_depth_memory, nullptr);
 	vkDestroyImage(vk_device, vk_image_depth, nullptr);
+	graphics::memory::free(vk_image_depth_allocation);
 
-	vkDestroyCommandPool(vk_device, imgui_command_pool, nullptr);
 	vkDestroyRenderPass(vk_device, imgui_render_pass, nullptr);
 
-	for (size_t i = 0, e = vk_framebuffers.size(); i != e; ++i) {
-		vkDestroyFramebuffer(vk_device, vk_framebuffers[i], nullptr);
-		vkDestroyFramebuffer(vk_device, imgui_framebuffers[i], nullptr);
-		vkDestroyImageView(vk_device, vk_swapchain_image_views[i], nullptr);
+	for (VkFramebuffer framebuffer : vk_framebuffers) {
+		vkDestroyFramebuffer(vk_device, framebuffer, nullptr);
+	}
+
+	for (VkImageView view : vk_swapchain_image_views) {
+		vkDestroyImageView(vk_device, view, nullptr);
+	}
+
+	for (VkFramebuffer framebuffer : imgui_framebuffers) {
+		vkDestroyFramebuffer(vk_device, framebuffer, nullptr);
+	}
+
+	if (headless) {
+		for (size_t i = 0, e = vk_swapchain_images.size(); i != e; ++i) {
+			vkDestroyImage(vk_device, vk_swapchain_images[i], nullptr);
+			graphics::memory::free(offscreen_allocations[i]);
+		}
+
+		delete capture_buffer;
 	}
 
 	ImGui_ImplVulkan_Shutdown();
@@ -797,10 +1376,23 @@ int veekay::run(const veekay::ApplicationInfo& app_info) {
 	ImGui::DestroyContext();
 
 	vkDestroyDescriptorPool(vk_device, imgui_descriptor_pool, nullptr);
+
+	graphics::recording::shutdown();
+	graphics::profiler::shutdown();
+	graphics::shutdown();
 	
-	vkDestroySwapchainKHR(vk_device, vk_swapchain, nullptr);
+	// NOTE: Headless instance and device are created without surface and
+	//       swapchain extensions, their functions must not be called at all
+	if (!headless) {
+		vkDestroySwapchainKHR(vk_device, vk_swapchain, nullptr);
+	}
+
 	vkDestroyDevice(vk_device, nullptr);
-	vkDestroySurfaceKHR(vk_instance, vk_surface, nullptr);
+
+	if (!headless) {
+		vkDestroySurfaceKHR(vk_instance, vk_surface, nullptr);
+	}
+
 	vkb::destroy_debug_utils_messenger(vk_instance, vk_debug_messenger);
 	vkDestroyInstance(vk_instance, nullptr);
 
@@ -1,10 +1,12 @@
 #include <cstdint>
 #include <climits>
 #include <cstring>
+#include <cstdlib>
 #include <vector>
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <algorithm>
 
 #include <veekay/veekay.hpp>
 
@@ -16,26 +18,26 @@ namespace {
 
 constexpr uint32_t max_models = 1024;
 
-struct Vertex {
-	veekay::vec3 position;
-	veekay::vec3 normal;
-	veekay::vec2 uv;
-	// NOTE: You can add more attributes
-};
-
 struct SceneUniforms {
 	veekay::mat4 view_projection;
 };
 
+// NOTE: Model transform is uploaded as affine3x4 (mat3x4 in shaders),
+//       which makes this structure 64 bytes instead of 80. Models are packed
+//       tightly in a storage buffer indexed by instance, dynamic uniform offsets
+//       would pad each of them to minUniformBufferOffsetAlignment, often 256 bytes
 struct ModelUniforms {
-	veekay::mat4 model;
+	veekay::affine3x4 model;
 	veekay::vec3 albedo_color; float _pad0;
 };
 
+// NOTE: Vertices are quantized (see veekay/quantize.hpp),
+//       bounds are needed by vertex shader to decode positions
 struct Mesh {
 	veekay::graphics::Buffer* vertex_buffer;
 	veekay::graphics::Buffer* index_buffer;
 	uint32_t indices;
+	veekay::quantize::Bounds bounds;
 };
 
 struct Transform {
@@ -53,6 +55,18 @@ struct Model {
 	veekay::vec3 albedo_color;
 };
 
+// NOTE: Simulation state of a model, owned by simulation thread
+struct Body {
+	Transform transform;
+	veekay::vec3 angular_velocity;
+};
+
+// NOTE: Written by every simulation tick, update blends two latest ones
+struct SceneSnapshot {
+	uint32_t model_count;
+	Transform transforms[max_models];
+};
+
 struct Camera {
 	constexpr static float default_fov = 60.0f;
 	constexpr static float default_near_plane = 0.01f;
@@ -79,6 +93,29 @@ inline namespace {
 	};
 
 	std::vector<Model> models;
+
+	// NOTE: Model transforms in a form suitable for batched matrix computation
+	veekay::TransformBatch model_transforms;
+
+	// NOTE: Advanced by simulation thread only, models get their
+	//       transforms from snapshots of it
+	std::vector<Body> bodies;
+
+	bool show_memory_stats;
+	bool show_gpu_profiler;
+	bool show_frame_times;
+
+	// NOTE: Record model draws on several threads into secondary command buffers
+	bool parallel_recording = true;
+
+	// NOTE: ImGui is drawn by render graph along with scene
+	bool integrated_ui = true;
+
+	// NOTE: Camera is updated from input sampled just before submission
+	bool late_latch = true;
+
+	// NOTE: Camera ignores mouse while it is over UI
+	bool ui_hovered;
 }
 
 // NOTE: Vulkan objects
@@ -93,8 +130,8 @@ inline namespace {
 	VkPipelineLayout pipeline_layout;
 	VkPipeline pipeline;
 
-	veekay::graphics::Buffer* scene_uniforms_buffer;
-	veekay::graphics::Buffer* model_uniforms_buffer;
+	veekay::graphics::PerFrameBuffer* scene_uniforms_buffer;
+	veekay::graphics::PerFrameBuffer* model_uniforms_buffer;
 
 	Mesh plane_mesh;
 	Mesh cube_mesh;
@@ -104,6 +141,12 @@ inline namespace {
 
 	veekay::graphics::Texture* texture;
 	VkSampler texture_sampler;
+
+	// NOTE: Built on first frame and again when recording mode changes
+	veekay::graphics::RenderGraph* render_graph;
+	bool render_graph_parallel;
+	veekay::graphics::GraphImage graph_color;
+	veekay::graphics::GraphImage graph_depth;
 }
 
 float toRadians(float degrees) {
@@ -111,11 +154,18 @@ float toRadians(float degrees) {
 }
 
 veekay::mat4 Transform::matrix() const {
-	// TODO: Scaling and rotation
-
+	auto s = veekay::mat4::scaling(scale);
+	auto rx = veekay::mat4::rotation({1.0f, 0.0f, 0.0f}, rotation.x);
+	auto ry = veekay::mat4::rotation({0.0f, 1.0f, 0.0f}, rotation.y);
+	auto rz = veekay::mat4::rotation({0.0f, 0.0f, 1.0f}, rotation.z);
 	auto t = veekay::mat4::translation(position);
 
-	return t;
+	// NOTE: Same composition as veekay::TransformBatch uses
+	return s * rx * ry * rz * t;
+}
+
+veekay::vec3 lerp(const veekay::vec3& a, const veekay::vec3& b, float t) {
+	return a + (b - a) * t;
 }
 
 veekay::mat4 Camera::view() const {
@@ -195,41 +245,20 @@ void initialize(VkCommandBuffer cmd) {
 		};
 
 		// NOTE: How many bytes does a vertex take?
-		VkVertexInputBindingDescription buffer_binding{
-			.binding = 0,
-			.stride = sizeof(Vertex),
-			.inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-		};
+		const VkVertexInputBindingDescription buffer_binding =
+			veekay::quantize::bindingDescription(0);
 
-		// NOTE: Declare vertex attributes
-		VkVertexInputAttributeDescription attributes[] = {
-			{
-				.location = 0, // NOTE: First attribute
-				.binding = 0, // NOTE: First vertex buffer
-				.format = VK_FORMAT_R32G32B32_SFLOAT, // NOTE: 3-component vector of floats
-				.offset = offsetof(Vertex, position), // NOTE: Offset of "position" field in a Vertex struct
-			},
-			{
-				.location = 1,
-				.binding = 0,
-				.format = VK_FORMAT_R32G32B32_SFLOAT,
-				.offset = offsetof(Vertex, normal),
-			},
-			{
-				.location = 2,
-				.binding = 0,
-				.format = VK_FORMAT_R32G32_SFLOAT,
-				.offset = offsetof(Vertex, uv),
-			},
-		};
+		// NOTE: Declare vertex attributes: 16-bit normalized position,
+		//       octahedral normal and half-float uv
+		const auto attributes = veekay::quantize::attributeDescriptions(0);
 
 		// NOTE: Describe inputs
 		VkPipelineVertexInputStateCreateInfo input_state_info{
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
 			.vertexBindingDescriptionCount = 1,
 			.pVertexBindingDescriptions = &buffer_binding,
-			.vertexAttributeDescriptionCount = sizeof(attributes) / sizeof(attributes[0]),
-			.pVertexAttributeDescriptions = attributes,
+			.vertexAttributeDescriptionCount = uint32_t(attributes.size()),
+			.pVertexAttributeDescriptions = attributes.data(),
 		};
 
 		// NOTE: Every three vertices make up a triangle,
@@ -313,11 +342,11 @@ void initialize(VkCommandBuffer cmd) {
 		{
 			VkDescriptorPoolSize pools[] = {
 				{
-					.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+					.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
 					.descriptorCount = 8,
 				},
 				{
-					.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+					.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
 					.descriptorCount = 8,
 				},
 				{
@@ -346,15 +375,15 @@ void initialize(VkCommandBuffer cmd) {
 			VkDescriptorSetLayoutBinding bindings[] = {
 				{
 					.binding = 0,
-					.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+					.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
 					.descriptorCount = 1,
 					.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
 				},
 				{
 					.binding = 1,
-					.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+					.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
 					.descriptorCount = 1,
-					.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+					.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
 				},
 			};
 
@@ -387,11 +416,20 @@ void initialize(VkCommandBuffer cmd) {
 			}
 		}
 
-		// NOTE: Declare external data sources, only push constants this time
+		// NOTE: Mesh bounds for vertex position decoding
+		VkPushConstantRange push_constants{
+			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+			.offset = 0,
+			.size = sizeof(veekay::quantize::Bounds),
+		};
+
+		// NOTE: Declare external data sources
 		VkPipelineLayoutCreateInfo layout_info{
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
 			.setLayoutCount = 1,
 			.pSetLayouts = &descriptor_set_layout,
+			.pushConstantRangeCount = 1,
+			.pPushConstantRanges = &push_constants,
 		};
 
 		// NOTE: Create pipeline layout
@@ -401,9 +439,19 @@ void initialize(VkCommandBuffer cmd) {
 			veekay::app.running = false;
 			return;
 		}
+
+
+		// NOTE: Pipeline is used inside dynamic rendering with these attachments
+		VkPipelineRenderingCreateInfoKHR rendering_info{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR,
+			.colorAttachmentCount = 1,
+			.pColorAttachmentFormats = &veekay::app.vk_color_format,
+			.depthAttachmentFormat = veekay::app.vk_depth_format,
+		};
 		
 		VkGraphicsPipelineCreateInfo info{
 			.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+			.pNext = &rendering_info,
 			.stageCount = 2,
 			.pStages = stage_infos,
 			.pVertexInputState = &input_state_info,
@@ -414,11 +462,10 @@ void initialize(VkCommandBuffer cmd) {
 			.pDepthStencilState = &depth_info,
 			.pColorBlendState = &blend_info,
 			.layout = pipeline_layout,
-			.renderPass = veekay::app.vk_render_pass,
 		};
 
 		// NOTE: Create graphics pipeline
-		if (vkCreateGraphicsPipelines(device, nullptr,
+		if (vkCreateGraphicsPipelines(device, veekay::app.vk_pipeline_cache,
 		                              1, &info, nullptr, &pipeline) != VK_SUCCESS) {
 			std::cerr << "Failed to create Vulkan pipeline\n";
 			veekay::app.running = false;
@@ -426,15 +473,15 @@ void initialize(VkCommandBuffer cmd) {
 		}
 	}
 
-	scene_uniforms_buffer = new veekay::graphics::Buffer(
+	// NOTE: Uniforms are rewritten every frame, each frame in flight gets own copy
+	scene_uniforms_buffer = new veekay::graphics::PerFrameBuffer(
 		sizeof(SceneUniforms),
-		nullptr,
 		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
 
-	model_uniforms_buffer = new veekay::graphics::Buffer(
-		max_models * veekay::graphics::Buffer::structureAlignment(sizeof(ModelUniforms)),
-		nullptr,
-		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	// NOTE: Frame slot is 64 KiB, a multiple of any minStorageBufferOffsetAlignment
+	model_uniforms_buffer = new veekay::graphics::PerFrameBuffer(
+		max_models * sizeof(ModelUniforms),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
 
 	// NOTE: This texture and sampler is used when texture could not be loaded
 	{
@@ -469,7 +516,7 @@ void initialize(VkCommandBuffer cmd) {
 			{
 				.buffer = model_uniforms_buffer->buffer,
 				.offset = 0,
-				.range = sizeof(ModelUniforms),
+				.range = max_models * sizeof(ModelUniforms),
 			},
 		};
 
@@ -480,7 +527,7 @@ void initialize(VkCommandBuffer cmd) {
 				.dstBinding = 0,
 				.dstArrayElement = 0,
 				.descriptorCount = 1,
-				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
 				.pBufferInfo = &buffer_infos[0],
 			},
 			{
@@ -489,7 +536,7 @@ void initialize(VkCommandBuffer cmd) {
 				.dstBinding = 1,
 				.dstArrayElement = 0,
 				.descriptorCount = 1,
-				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
 				.pBufferInfo = &buffer_infos[1],
 			},
 		};
@@ -500,85 +547,37 @@ void initialize(VkCommandBuffer cmd) {
 
 	// NOTE: Plane mesh initialization
 	{
-		// (v0)------(v1)
-		//  |  \       |
-		//  |   `--,   |
-		//  |       \  |
-		// (v3)------(v2)
-		std::vector<Vertex> vertices = {
-			{{-5.0f, 0.0f, 5.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f}},
-			{{5.0f, 0.0f, 5.0f}, {0.0f, -1.0f, 0.0f}, {1.0f, 0.0f}},
-			{{5.0f, 0.0f, -5.0f}, {0.0f, -1.0f, 0.0f}, {1.0f, 1.0f}},
-			{{-5.0f, 0.0f, -5.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 1.0f}},
-		};
-
-		std::vector<uint32_t> indices = {
-			0, 1, 2, 2, 3, 0
-		};
+		// NOTE: Mesh data is generated and quantized at compile time
+		//       and stored in executable, then copied into device local memory
+		static constexpr auto plane = veekay::quantize::mesh(
+			veekay::geometry::plane(10.0f, 10.0f));
 
 		plane_mesh.vertex_buffer = new veekay::graphics::Buffer(
-			vertices.size() * sizeof(Vertex), vertices.data(),
+			cmd, sizeof(plane.vertices), plane.vertices.data(),
 			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
 
 		plane_mesh.index_buffer = new veekay::graphics::Buffer(
-			indices.size() * sizeof(uint32_t), indices.data(),
+			cmd, sizeof(plane.indices), plane.indices.data(),
 			VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
-		plane_mesh.indices = uint32_t(indices.size());
+		plane_mesh.indices = uint32_t(plane.indices.size());
+		plane_mesh.bounds = plane.bounds;
 	}
 
 	// NOTE: Cube mesh initialization
 	{
-		std::vector<Vertex> vertices = {
-			{{-0.5f, -0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {0.0f, 0.0f}},
-			{{+0.5f, -0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {1.0f, 0.0f}},
-			{{+0.5f, +0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {1.0f, 1.0f}},
-			{{-0.5f, +0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f}},
-
-			{{+0.5f, -0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-			{{+0.5f, -0.5f, +0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
-			{{+0.5f, +0.5f, +0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},
-			{{+0.5f, +0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
-
-			{{+0.5f, -0.5f, +0.5f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f}},
-			{{-0.5f, -0.5f, +0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f}},
-			{{-0.5f, +0.5f, +0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-			{{+0.5f, +0.5f, +0.5f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}},
-
-			{{-0.5f, -0.5f, +0.5f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-			{{-0.5f, -0.5f, -0.5f}, {-1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
-			{{-0.5f, +0.5f, -0.5f}, {-1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},
-			{{-0.5f, +0.5f, +0.5f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
-
-			{{-0.5f, -0.5f, +0.5f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f}},
-			{{+0.5f, -0.5f, +0.5f}, {0.0f, -1.0f, 0.0f}, {1.0f, 0.0f}},
-			{{+0.5f, -0.5f, -0.5f}, {0.0f, -1.0f, 0.0f}, {1.0f, 1.0f}},
-			{{-0.5f, -0.5f, -0.5f}, {0.0f, -1.0f, 0.0f}, {0.0f, 1.0f}},
-
-			{{-0.5f, +0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
-			{{+0.5f, +0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-			{{+0.5f, +0.5f, +0.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f}},
-			{{-0.5f, +0.5f, +0.5f}, {0.0f, 1.0f, 0.0f}, {0.0f, 1.0f}},
-		};
-
-		std::vector<uint32_t> indices = {
-			0, 1, 2, 2, 3, 0,
-			4, 5, 6, 6, 7, 4,
-			8, 9, 10, 10, 11, 8,
-			12, 13, 14, 14, 15, 12,
-			16, 17, 18, 18, 19, 16,
-			20, 21, 22, 22, 23, 20,
-		};
+		static constexpr auto cube = veekay::quantize::mesh(veekay::geometry::cube());
 
 		cube_mesh.vertex_buffer = new veekay::graphics::Buffer(
-			vertices.size() * sizeof(Vertex), vertices.data(),
+			cmd, sizeof(cube.vertices), cube.vertices.data(),
 			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
 
 		cube_mesh.index_buffer = new veekay::graphics::Buffer(
-			indices.size() * sizeof(uint32_t), indices.data(),
+			cmd, sizeof(cube.indices), cube.indices.data(),
 			VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
-		cube_mesh.indices = uint32_t(indices.size());
+		cube_mesh.indices = uint32_t(cube.indices.size());
+		cube_mesh.bounds = cube.bounds;
 	}
 
 	// NOTE: Add models to scene
@@ -611,12 +610,35 @@ void initialize(VkCommandBuffer cmd) {
 		},
 		.albedo_color = veekay::vec3{0.0f, 0.0f, 1.0f}
 	});
+
+	// NOTE: Cubes spin at different rates, plane stays still
+	for (size_t i = 0, n = models.size(); i < n; ++i) {
+		bodies.push_back(Body{
+			.transform = models[i].transform,
+			.angular_velocity = {0.0f, i == 0 ? 0.0f : 0.5f * float(i), 0.0f},
+		});
+	}
+}
+
+// NOTE: Runs on simulation thread at a fixed rate, see SimulationInfo
+void simulate(double, double dt, void* snapshot) {
+	SceneSnapshot& scene = *static_cast<SceneSnapshot*>(snapshot);
+	scene.model_count = uint32_t(std::min<size_t>(bodies.size(), max_models));
+
+	for (uint32_t i = 0; i < scene.model_count; ++i) {
+		Body& body = bodies[i];
+		body.transform.rotation += body.angular_velocity * float(dt);
+
+		scene.transforms[i] = body.transform;
+	}
 }
 
 // NOTE: Destroy resources here, do not cause leaks in your program!
 void shutdown() {
 	VkDevice& device = veekay::app.vk_device;
 
+	delete render_graph;
+
 	vkDestroySampler(device, missing_texture_sampler, nullptr);
 	delete missing_texture;
 
@@ -638,11 +660,10 @@ void shutdown() {
 	vkDestroyShaderModule(device, vertex_shader_module, nullptr);
 }
 
-void update(double time) {
-	ImGui::Begin("Controls:");
-	ImGui::End();
-
-	if (!ImGui::IsWindowHovered()) {
+// NOTE: Moves camera with input and writes scene uniforms of this frame,
+//       with late latch it runs right before submission instead of in update
+void updateCamera() {
+	if (!ui_hovered) {
 		using namespace veekay::input;
 
 		if (mouse::isButtonDown(mouse::Button::left)) {
@@ -682,79 +703,132 @@ void update(double time) {
 		.view_projection = camera.view_projection(aspect_ratio),
 	};
 
-	std::vector<ModelUniforms> model_uniforms(models.size());
-	for (size_t i = 0, n = models.size(); i < n; ++i) {
-		const Model& model = models[i];
-		ModelUniforms& uniforms = model_uniforms[i];
+	*(SceneUniforms*)scene_uniforms_buffer->data() = scene_uniforms;
+}
+
+void update(double time) {
+	ImGui::Begin("Controls:");
+	ImGui::Checkbox("Memory statistics", &show_memory_stats);
 
-		uniforms.model = model.transform.matrix();
-		uniforms.albedo_color = model.albedo_color;
+	if (ImGui::Button("Dump memory to memory.json")) {
+		std::ofstream file("memory.json");
+		veekay::graphics::memory::writeJson(file);
 	}
 
-	*(SceneUniforms*)scene_uniforms_buffer->mapped_region = scene_uniforms;
+	ImGui::Checkbox("GPU profiler", &show_gpu_profiler);
 
-	const size_t alignment =
-		veekay::graphics::Buffer::structureAlignment(sizeof(ModelUniforms));
+	if (ImGui::Button("Dump GPU profile to gpu_profile.csv")) {
+		std::ofstream file("gpu_profile.csv");
+		veekay::graphics::profiler::writeCsv(file);
+	}
+
+	ImGui::Checkbox("Frame times", &show_frame_times);
+	ImGui::Checkbox("Parallel recording", &parallel_recording);
 
-	for (size_t i = 0, n = model_uniforms.size(); i < n; ++i) {
-		const ModelUniforms& uniforms = model_uniforms[i];
+	ImGui::Text("Input to submit: %.2f ms (%s)", veekay::app.input_latency * 1000.0,
+	            late_latch ? "late latched" : "polled at frame start");
 
-		char* const pointer = static_cast<char*>(model_uniforms_buffer->mapped_region) + i * alignment;
-		*reinterpret_cast<ModelUniforms*>(pointer) = uniforms;
+	ImGui::Text("Simulation: %llu ticks, %llu skipped",
+	            (unsigned long long)veekay::simulation::tickCount(),
+	            (unsigned long long)veekay::simulation::skippedTicks());
+
+	if (render_graph) {
+		const veekay::graphics::GraphStats& stats = render_graph->stats;
+		ImGui::Text("Render graph: %u passes, %u barriers", stats.passes, stats.image_barriers);
 	}
-}
 
-void render(VkCommandBuffer cmd, VkFramebuffer framebuffer) {
-	vkResetCommandBuffer(cmd, 0);
+	if (ImGui::Button("Dump CPU trace to trace.json")) {
+		std::ofstream file("trace.json");
+		veekay::trace::writeChromeJson(file);
+	}
+	ImGui::End();
 
-	{ // NOTE: Start recording rendering commands
-		VkCommandBufferBeginInfo info{
-			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-		};
+	if (show_frame_times) {
+		veekay::trace::drawImGui(&show_frame_times);
+	}
 
-		vkBeginCommandBuffer(cmd, &info);
+	if (show_memory_stats) {
+		veekay::graphics::memory::drawImGui(&show_memory_stats);
 	}
 
-	{ // NOTE: Use current swapchain framebuffer and clear it
-		VkClearValue clear_color{.color = {{0.1f, 0.1f, 0.1f, 1.0f}}};
-		VkClearValue clear_depth{.depthStencil = {1.0f, 0}};
+	if (show_gpu_profiler) {
+		veekay::graphics::profiler::drawImGui(&show_gpu_profiler);
+	}
 
-		VkClearValue clear_values[] = {clear_color, clear_depth};
+	ui_hovered = ImGui::IsWindowHovered();
 
-		VkRenderPassBeginInfo info{
-			.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-			.renderPass = veekay::app.vk_render_pass,
-			.framebuffer = framebuffer,
-			.renderArea = {
-				.extent = {
-					veekay::app.window_width,
-					veekay::app.window_height
-				},
-			},
-			.clearValueCount = 2,
-			.pClearValues = clear_values,
-		};
+	if (!late_latch) {
+		updateCamera();
+	}
+
+	{ // NOTE: Rendered state lies between two latest simulation ticks
+		auto previous = static_cast<const SceneSnapshot*>(veekay::simulation::previous());
+		auto current = static_cast<const SceneSnapshot*>(veekay::simulation::current());
+		const float alpha = veekay::simulation::alpha();
+
+		for (uint32_t i = 0; i < current->model_count; ++i) {
+			const Transform& from = previous->transforms[i];
+			const Transform& to = current->transforms[i];
+
+			models[i].transform = Transform{
+				.position = lerp(from.position, to.position, alpha),
+				.scale = lerp(from.scale, to.scale, alpha),
+				.rotation = lerp(from.rotation, to.rotation, alpha),
+			};
+		}
+	}
 
-		vkCmdBeginRenderPass(cmd, &info, VK_SUBPASS_CONTENTS_INLINE);
+	model_transforms.resize(models.size());
+
+	for (size_t i = 0, n = models.size(); i < n; ++i) {
+		const Transform& transform = models[i].transform;
+		model_transforms.set(i, transform.position, transform.rotation, transform.scale);
 	}
 
+	// NOTE: Model transforms are written straight into mapped buffer memory
+	static_assert(offsetof(ModelUniforms, model) == 0);
+	static_assert(sizeof(ModelUniforms) == 64);
+
+	ModelUniforms* const model_uniforms = static_cast<ModelUniforms*>(model_uniforms_buffer->data());
+
+	veekay::jobs::parallelFor(models.size(), 1024, [&](size_t begin, size_t end) {
+		model_transforms.computeAffine(begin, end - begin, model_uniforms + begin, sizeof(ModelUniforms));
+
+		for (size_t i = begin; i < end; ++i) {
+			model_uniforms[i].albedo_color = models[i].albedo_color;
+		}
+	});
+}
+
+// NOTE: Records draws of models [begin, end), binds everything it uses,
+//       since secondary command buffers start with no state
+void recordModels(VkCommandBuffer cmd, size_t begin, size_t end) {
 	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 	VkDeviceSize zero_offset = 0;
 
+	// NOTE: Dynamic offsets go in binding order: scene, then model frame slot.
+	//       Shader picks model by instance index, so set is bound once
+	uint32_t offsets[] = {
+		scene_uniforms_buffer->offset(),
+		model_uniforms_buffer->offset(),
+	};
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,
+	                        0, 1, &descriptor_set, 2, offsets);
+
 	VkBuffer current_vertex_buffer = VK_NULL_HANDLE;
 	VkBuffer current_index_buffer = VK_NULL_HANDLE;
 
-	const size_t model_uniorms_alignment =
-		veekay::graphics::Buffer::structureAlignment(sizeof(ModelUniforms));
-
-	for (size_t i = 0, n = models.size(); i < n; ++i) {
+	for (size_t i = begin; i < end; ++i) {
 		const Model& model = models[i];
 		const Mesh& mesh = model.mesh;
 
 		if (current_vertex_buffer != mesh.vertex_buffer->buffer) {
 			current_vertex_buffer = mesh.vertex_buffer->buffer;
 			vkCmdBindVertexBuffers(cmd, 0, 1, &current_vertex_buffer, &zero_offset);
+
+			vkCmdPushConstants(cmd, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT,
+			                   0, sizeof(mesh.bounds), &mesh.bounds);
 		}
 
 		if (current_index_buffer != mesh.index_buffer->buffer) {
@@ -762,24 +836,148 @@ void render(VkCommandBuffer cmd, VkFramebuffer framebuffer) {
 			vkCmdBindIndexBuffer(cmd, current_index_buffer, zero_offset, VK_INDEX_TYPE_UINT32);
 		}
 
-		uint32_t offset = i * model_uniorms_alignment;
-		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,
-		                    0, 1, &descriptor_set, 1, &offset);
+		vkCmdDrawIndexed(cmd, mesh.indices, 1, 0, 0, uint32_t(i));
+	}
+}
+
+// NOTE: Final layout of swapchain images is known only from render target
+void buildRenderGraph(const veekay::RenderTarget& target) {
+	using namespace veekay::graphics;
+
+	// NOTE: Frames in flight may still use the old graph
+	if (render_graph) {
+		RenderGraph* old_graph = render_graph;
+		destroyLater([old_graph]() { delete old_graph; });
+	}
+
+	render_graph = new RenderGraph();
+	render_graph_parallel = parallel_recording;
+
+	graph_color = render_graph->importImage("Swapchain", veekay::app.vk_color_format,
+	                                        VK_IMAGE_LAYOUT_UNDEFINED, target.color_final_layout);
+
+	// NOTE: Transient depth is dropped at the end of a frame
+	const bool depth_stored = target.depth_store_op == VK_ATTACHMENT_STORE_OP_STORE;
+
+	graph_depth = render_graph->importImage("Depth", veekay::app.vk_depth_format,
+	                                        VK_IMAGE_LAYOUT_UNDEFINED,
+	                                        depth_stored ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+	                                                     : VK_IMAGE_LAYOUT_UNDEFINED);
+
+	VkClearValue clear_color{.color = {{0.1f, 0.1f, 0.1f, 1.0f}}};
+	VkClearValue clear_depth{.depthStencil = {1.0f, 0}};
+
+	// NOTE: Rendering with secondary command buffers allows nothing else inside,
+	//       so with parallel recording ImGui goes into a secondary buffer of its own.
+	//       Either way it stays in scene rendering, so color and depth are
+	//       not loaded and stored once more for it
+	const bool parallel = parallel_recording;
+
+	GraphPass scene = render_graph->addPass("Scene", [parallel](VkCommandBuffer cmd) {
+		if (parallel) {
+			VkCommandBufferInheritanceRenderingInfoKHR inheritance{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR,
+				.colorAttachmentCount = 1,
+				.pColorAttachmentFormats = &veekay::app.vk_color_format,
+				.depthAttachmentFormat = veekay::app.vk_depth_format,
+				.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+			};
+
+			recordParallel(cmd, inheritance, models.size(), recordModels);
+
+			if (integrated_ui) {
+				recordParallel(cmd, inheritance, 1, [](VkCommandBuffer secondary, size_t, size_t) {
+					veekay::renderImGui(secondary);
+				}, 1);
+			}
+		} else {
+			recordModels(cmd, 0, models.size());
+
+			if (integrated_ui) {
+				veekay::renderImGui(cmd);
+			}
+		}
+	}, parallel ? VkRenderingFlagsKHR(VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR) : 0);
+
+	render_graph->write(scene, graph_color, GraphAccess::color_attachment, &clear_color);
+	render_graph->write(scene, graph_depth, GraphAccess::depth_attachment, &clear_depth);
+
+	render_graph->compile();
+}
+
+void render(VkCommandBuffer cmd, const veekay::RenderTarget& target) {
+	if (!render_graph || render_graph_parallel != parallel_recording) {
+		buildRenderGraph(target);
+	}
 
-		vkCmdDrawIndexed(cmd, mesh.indices, 1, 0, 0, 0);
+	{ // NOTE: Start recording rendering commands
+		VkCommandBufferBeginInfo info{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		};
+
+		vkBeginCommandBuffer(cmd, &info);
 	}
 
-	vkCmdEndRenderPass(cmd);
+	render_graph->setImage(graph_color, target.color_image, target.color_view,
+	                       target.extent.width, target.extent.height);
+	render_graph->setImage(graph_depth, target.depth_image, target.depth_view,
+	                       target.extent.width, target.extent.height);
+
+	veekay::graphics::profiler::begin(cmd, "Scene");
+	render_graph->execute(cmd);
+	veekay::graphics::profiler::end(cmd);
+
 	vkEndCommandBuffer(cmd);
 }
 
 } // namespace
 
-int main() {
+// NOTE: "--headless <frames>" renders offscreen without a window,
+//       "--capture <path>" additionally saves the last frame,
+//       "--separate-ui" draws ImGui after the graph, "--stored-depth"
+//       keeps depth in memory after a frame and "--no-late-latch" updates
+//       camera at the start of a frame for comparison
+int main(int argc, char** argv) {
+	veekay::HeadlessInfo headless{};
+	veekay::DepthAttachment depth = veekay::DepthAttachment::transient;
+
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--headless") == 0 && i + 1 < argc) {
+			headless.enabled = true;
+			headless.frames = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+			headless.capture_path = argv[++i];
+		} else if (std::strcmp(argv[i], "--separate-ui") == 0) {
+			integrated_ui = false;
+		} else if (std::strcmp(argv[i], "--stored-depth") == 0) {
+			depth = veekay::DepthAttachment::stored;
+		} else if (std::strcmp(argv[i], "--no-late-latch") == 0) {
+			late_latch = false;
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--headless <frames>] [--capture <path>]"
+			          << " [--separate-ui] [--stored-depth] [--no-late-latch]\n";
+			return 1;
+		}
+	}
+
+	if (headless.capture_path) {
+		headless.capture_interval = headless.frames;
+	}
+
 	return veekay::run({
 		.init = initialize,
 		.shutdown = shutdown,
 		.update = update,
-		.render = render,
+		.render_dynamic = render,
+		.late_latch = late_latch ? updateCamera : nullptr,
+		.headless = headless,
+		.simulation = {
+			.tick = simulate,
+			.tick_rate = 60,
+			.snapshot_size = sizeof(SceneSnapshot),
+		},
+		.depth = depth,
+		.integrated_ui = integrated_ui,
 	});
 }
@@ -0,0 +1,197 @@
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <random>
+#include <iostream>
+
+#include <veekay/types.hpp>
+
+// NOTE: Compares mat4 and vec4 arithmetic against the scalar loops
+//       they replaced. Element-wise operations and transpose must match
+//       bit for bit, products within "product_tolerance" ULP, which only
+//       leaves room for a compiler contracting the reference into FMA.
+//       Zeros of either sign compare equal
+
+namespace {
+
+constexpr uint32_t iterations = 100'000;
+constexpr uint32_t exact_tolerance = 0;
+constexpr uint32_t product_tolerance = 2;
+
+struct Reference {
+	float elements[4][4];
+};
+
+Reference multiply(const Reference& lhs, const Reference& rhs) {
+	Reference result{};
+
+	for (int j = 0; j < 4; j++) {
+		for (int i = 0; i < 4; i++) {
+			for (int k = 0; k < 4; k++) {
+				result.elements[j][i] += lhs.elements[j][k] * rhs.elements[k][i];
+			}
+		}
+	}
+
+	return result;
+}
+
+Reference transpose(const Reference& matrix) {
+	Reference result{};
+
+	for (int j = 0; j < 4; ++j) {
+		for (int i = 0; i < 4; ++i) {
+			result.elements[j][i] = matrix.elements[i][j];
+		}
+	}
+
+	return result;
+}
+
+void multiply(const Reference& matrix, const float* vector, float* result) {
+	for (int i = 0; i < 4; ++i) {
+		result[i] = 0.0f;
+	}
+
+	for (int j = 0; j < 4; ++j) {
+		for (int i = 0; i < 4; ++i) {
+			result[i] += matrix.elements[j][i] * vector[j];
+		}
+	}
+}
+
+uint32_t ulpDistance(float lhs, float rhs) {
+	if (lhs == rhs) {
+		return 0;
+	}
+
+	int32_t a, b;
+	std::memcpy(&a, &lhs, sizeof(a));
+	std::memcpy(&b, &rhs, sizeof(b));
+
+	// NOTE: Maps floats onto integers that are ordered the same way
+	if (a < 0) { a = INT32_MIN - a; }
+	if (b < 0) { b = INT32_MIN - b; }
+
+	return a > b ? uint32_t(int64_t(a) - b) : uint32_t(int64_t(b) - a);
+}
+
+struct Check {
+	const char* name;
+	uint32_t tolerance;
+
+	uint32_t max_distance = 0;
+	uint64_t mismatches = 0;
+
+	void compare(const float* actual, const float* expected, size_t count) {
+		for (size_t i = 0; i < count; ++i) {
+			const uint32_t distance = ulpDistance(actual[i], expected[i]);
+
+			max_distance = std::max(max_distance, distance);
+
+			if (distance > tolerance) {
+				++mismatches;
+			}
+		}
+	}
+
+	bool report() const {
+		std::cout << (mismatches == 0 ? "[ OK ] " : "[FAIL] ") << name
+		          << ": max " << max_distance << " ULP, tolerance " << tolerance
+		          << " ULP, " << mismatches << " mismatches\n";
+
+		return mismatches == 0;
+	}
+};
+
+const char* backend() {
+#if defined(VEEKAY_SIMD_AVX)
+	return "AVX";
+#elif defined(VEEKAY_SIMD_SSE)
+	return "SSE";
+#elif defined(VEEKAY_SIMD_NEON)
+	return "NEON";
+#else
+	return "scalar";
+#endif
+}
+
+} // namespace
+
+int main() {
+	std::mt19937 engine(1337);
+	std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+
+	Check checks[] = {
+		{"mat4 * mat4", product_tolerance},
+		{"mat4 * vec4", product_tolerance},
+		{"mat4::transpose", exact_tolerance},
+		{"vec4 + vec4", exact_tolerance},
+		{"vec4 - vec4", exact_tolerance},
+		{"vec4 * vec4", exact_tolerance},
+		{"vec4 / vec4", exact_tolerance},
+	};
+
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		veekay::mat4 lhs, rhs;
+		veekay::vec4 a, b;
+
+		for (int j = 0; j < 4; ++j) {
+			for (int i = 0; i < 4; ++i) {
+				lhs.elements[j][i] = distribution(engine);
+				rhs.elements[j][i] = distribution(engine);
+			}
+
+			a.elements[j] = distribution(engine);
+			b.elements[j] = distribution(engine);
+		}
+
+		Reference reference_lhs, reference_rhs;
+		std::memcpy(reference_lhs.elements, lhs.elements, sizeof(lhs.elements));
+		std::memcpy(reference_rhs.elements, rhs.elements, sizeof(rhs.elements));
+
+		{
+			const veekay::mat4 actual = lhs * rhs;
+			const Reference expected = multiply(reference_lhs, reference_rhs);
+			checks[0].compare(&actual.elements[0][0], &expected.elements[0][0], 16);
+		}
+
+		{
+			const veekay::vec4 actual = lhs * a;
+			float expected[4];
+			multiply(reference_lhs, a.elements, expected);
+			checks[1].compare(actual.elements, expected, 4);
+		}
+
+		{
+			const veekay::mat4 actual = veekay::mat4::transpose(lhs);
+			const Reference expected = transpose(reference_lhs);
+			checks[2].compare(&actual.elements[0][0], &expected.elements[0][0], 16);
+		}
+
+		float expected[4][4];
+
+		for (int i = 0; i < 4; ++i) {
+			expected[0][i] = a.elements[i] + b.elements[i];
+			expected[1][i] = a.elements[i] - b.elements[i];
+			expected[2][i] = a.elements[i] * b.elements[i];
+			expected[3][i] = a.elements[i] / b.elements[i];
+		}
+
+		const veekay::vec4 actual[] = {a + b, a - b, a * b, a / b};
+
+		for (int k = 0; k < 4; ++k) {
+			checks[3 + k].compare(actual[k].elements, expected[k], 4);
+		}
+	}
+
+	std::cout << "Backend: " << backend() << ", " << iterations << " iterations\n";
+
+	bool passed = true;
+
+	for (const Check& check : checks) {
+		passed = check.report() && passed;
+	}
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <initializer_list>
+#include <iostream>
+
+#include <veekay/veekay.hpp>
+
+// NOTE: Compiles small render graphs on a headless device and checks pass
+//       order, culling and memory aliasing. Exits with skip_code when no
+//       Vulkan device is available, e.g. on build servers without lavapipe
+
+namespace {
+
+constexpr int skip_code = 77;
+
+using namespace veekay::graphics;
+
+bool initialized;
+uint32_t failures;
+
+void check(bool condition, const char* name) {
+	std::cout << (condition ? "[ OK ] " : "[FAIL] ") << name << '\n';
+
+	if (!condition) {
+		++failures;
+	}
+}
+
+bool passOrder(const RenderGraph& graph, std::initializer_list<const char*> names) {
+	if (graph.passes.size() != names.size()) {
+		return false;
+	}
+
+	size_t index = 0;
+
+	for (const char* name : names) {
+		if (std::strcmp(graph.passes[index++].name, name) != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// NOTE: Compiling throws with "message" in what()
+bool throwsOnCompile(RenderGraph& graph, const char* message) {
+	try {
+		graph.compile();
+	} catch (const std::exception& e) {
+		return std::strstr(e.what(), message) != nullptr;
+	}
+
+	return false;
+}
+
+void testOrderAndAliasing() {
+	RenderGraph graph;
+
+	VkClearValue clear{};
+
+	const GraphImageInfo info{.format = VK_FORMAT_R8G8B8A8_UNORM, .width = 64, .height = 64};
+
+	GraphImage color = graph.importImage("Color", VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED,
+	                                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+	GraphImage first = graph.createImage("First", info);
+	GraphImage second = graph.createImage("Second", info);
+	GraphImage unused = graph.createImage("Unused", info);
+
+	// NOTE: Declared before the pass that writes what it samples
+	GraphPass use_first = graph.addPass("Use first", [](VkCommandBuffer) {});
+	graph.read(use_first, first, GraphAccess::sampled);
+	graph.write(use_first, color, GraphAccess::color_attachment, &clear);
+
+	GraphPass make_first = graph.addPass("Make first", [](VkCommandBuffer) {});
+	graph.write(make_first, first, GraphAccess::color_attachment, &clear);
+
+	GraphPass make_second = graph.addPass("Make second", [](VkCommandBuffer) {});
+	graph.write(make_second, second, GraphAccess::color_attachment, &clear);
+
+	GraphPass use_second = graph.addPass("Use second", [](VkCommandBuffer) {});
+	graph.read(use_second, second, GraphAccess::sampled);
+	graph.write(use_second, color, GraphAccess::color_attachment);
+
+	GraphPass dead = graph.addPass("Dead", [](VkCommandBuffer) {});
+	graph.write(dead, unused, GraphAccess::color_attachment, &clear);
+
+	graph.compile();
+
+	check(passOrder(graph, {"Make first", "Use first", "Make second", "Use second", "Dead"}),
+	      "passes run after writes they read");
+	check(graph.passes.back().culled, "pass writing unused image is culled");
+	check(graph.stats.passes == 4 && graph.stats.culled_passes == 1, "stats count passes");
+
+	// NOTE: Both images are sampled, so they are not transient attachments,
+	//       and live in disjoint pass ranges, so they share one memory slot
+	check(graph.memory_slots.size() == 1, "images with disjoint lifetimes share memory");
+	check(graph.memory_slots.size() == 1 && graph.memory_slots[0].images.size() == 2,
+	      "shared memory slot holds both images");
+	check(graph.stats.aliased_size > 0 && graph.stats.aliased_size < graph.stats.transient_size,
+	      "aliasing saves memory");
+	check(graph.stats.barrier_batches > 0, "barriers are planned");
+}
+
+void testUnwrittenRead() {
+	RenderGraph graph;
+
+	VkClearValue clear{};
+
+	GraphImage color = graph.importImage("Color", VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED,
+	                                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+	GraphImage never = graph.createImage("Never written", {.format = VK_FORMAT_R8G8B8A8_UNORM});
+
+	GraphPass pass = graph.addPass("Reader", [](VkCommandBuffer) {});
+	graph.read(pass, never, GraphAccess::sampled);
+	graph.write(pass, color, GraphAccess::color_attachment, &clear);
+
+	check(throwsOnCompile(graph, "nothing writes"), "read of image nothing writes throws");
+}
+
+void testCycle() {
+	RenderGraph graph;
+
+	VkClearValue clear{};
+
+	const GraphImageInfo info{.format = VK_FORMAT_R8G8B8A8_UNORM};
+
+	GraphImage a = graph.createImage("A", info);
+	GraphImage b = graph.createImage("B", info);
+
+	GraphPass first = graph.addPass("First", [](VkCommandBuffer) {});
+	graph.read(first, b, GraphAccess::sampled);
+	graph.write(first, a, GraphAccess::color_attachment, &clear);
+
+	GraphPass second = graph.addPass("Second", [](VkCommandBuffer) {});
+	graph.read(second, a, GraphAccess::sampled);
+	graph.write(second, b, GraphAccess::color_attachment, &clear);
+
+	check(throwsOnCompile(graph, "cycle"), "passes waiting for each other throw");
+}
+
+void initialize(VkCommandBuffer) {
+	initialized = true;
+
+	try {
+		testOrderAndAliasing();
+		testUnwrittenRead();
+		testCycle();
+	} catch (const std::exception& e) {
+		std::cout << "[FAIL] " << e.what() << '\n';
+		++failures;
+	}
+
+	// NOTE: Nothing to render, main loop ends before the first frame
+	veekay::app.running = false;
+}
+
+void shutdown() {}
+
+void update(double) {}
+
+void render(VkCommandBuffer, const veekay::RenderTarget&) {}
+
+} // namespace
+
+int main() {
+	const int result = veekay::run({
+		.init = initialize,
+		.shutdown = shutdown,
+		.update = update,
+		.render_dynamic = render,
+		.headless = {.enabled = true},
+	});
+
+	if (!initialized) {
+		std::cout << "No Vulkan device, skipping\n";
+		return skip_code;
+	}
+
+	return (result == 0 && failures == 0) ? 0 : 1;
+}